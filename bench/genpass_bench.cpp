@@ -0,0 +1,609 @@
+/* ---------------------------------------------------------------------- *\
+ * bench/genpass_bench.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+// Microbenchmarks for the hot paths of libgenpass.
+//
+// usage: genpass_bench [--filter=SUBSTR] [--samples=N] [--min-time=SECONDS]
+//                      [--out=FILE]
+//
+// Every benchmark is run for `samples` samples, each at least
+// `min-time / samples` long, and the per-operation times are reported as
+// JSON. All inputs are generated from fixed seeds so runs are comparable.
+// Built with GENPASS_INSTRUMENT, the report also has the library's metrics.
+
+#include <fmt/base.h>            // for println
+#include <nlohmann/json.hpp>     // for basic_json
+#include <openssl/core_names.h>  // for OSSL_KDF_PARAM_ITER, OSSL_KDF_PARAM_...
+#include <openssl/evp.h>         // for EVP_EncryptInit_ex2, EVP_KDF_derive...
+#include <openssl/kdf.h>         // for EVP_KDF_fetch, EVP_KDF_CTX_new
+#include <stdio.h>               // for stderr
+#include <algorithm>             // for sort, shuffle
+#include <chrono>                // for steady_clock, duration
+#include <cstdint>               // for uint64_t
+#include <cstring>               // for strlen
+#include <filesystem>            // for path, temp_directory_path, remove
+#include <fstream>               // for ofstream
+#include <functional>            // for function
+#include <future>                // for future
+#include <iostream>              // for cout
+#include <memory>                // for shared_ptr
+#include <random>                // for mt19937_64
+#include <sstream>               // for ostringstream
+#include <stdexcept>             // for runtime_error
+#include <string>                // for string, to_string
+#include <thread>                // for thread
+#include <unordered_set>         // for unordered_set
+#include <utility>               // for pair
+#include <vector>                // for vector
+
+#include "genpass/AsyncGenerator.hpp" // for AsyncGenerator
+#include "genpass/CharClass.hpp" // for CharClass
+#include "genpass/Genpass.hpp"   // for Genpass
+#include "genpass/Metrics.hpp"   // for metricsSnapshot, metricsEnabled
+#include "genpass/Password.hpp"  // for PasswordV2, PasswordV3
+#include "genpass/Policy.hpp"    // for Policy, PolicyRules
+#include "genpass/ReverseIndex.hpp" // for ReverseIndex
+#include "genpass/SecureString.hpp" // for SecureString
+#include "genpass/Seed.hpp"      // for Seed
+#include "genpass/VaultFormat.hpp" // for VaultFormat
+#ifndef _WIN32
+#include "genpass/VaultFile.hpp" // for VaultFile
+#endif
+
+namespace {
+
+using namespace genpass;
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string filter;
+  unsigned samples = 10;
+  double minTime = 0.5;
+  std::string out;
+};
+
+template<typename T>
+inline void
+doNotOptimize(const T& value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+class Runner {
+public:
+  explicit Runner(const Options& opts) : opts(opts) { }
+
+  // Times `op`, which performs one operation per call.
+  void run(const std::string& name, const nlohmann::json& params,
+    const std::function<void()>& op
+  ) {
+    if(!opts.filter.empty() && name.find(opts.filter) == std::string::npos)
+      return;
+    fmt::println(stderr, "running {} {}", name, params.dump());
+
+    // find an iteration count that fills one sample
+    const double sampleTime = opts.minTime / opts.samples;
+    std::uint64_t iters = 1;
+    for(;;) {
+      const double t = time(op, iters);
+      if(t >= sampleTime || iters >= (std::uint64_t(1) << 40)) break;
+      iters = t <= 0 ? iters * 10
+        : std::max(iters + 1, (std::uint64_t)(iters * sampleTime / t * 1.2));
+    }
+
+    std::vector<double> perOp;
+    for(unsigned i = 0; i < opts.samples; i++)
+      perOp.push_back(time(op, iters) * 1e9 / iters);
+    std::sort(perOp.begin(), perOp.end());
+    double sum = 0;
+    for(double t : perOp) sum += t;
+
+    results.push_back({
+      {"name", name},
+      {"params", params},
+      {"iterations", iters},
+      {"samples", opts.samples},
+      {"ns_per_op", {
+        {"median", perOp[perOp.size() / 2]},
+        {"min", perOp.front()},
+        {"max", perOp.back()},
+        {"mean", sum / perOp.size()}
+      }}
+    });
+  }
+
+  nlohmann::json report() const {
+    return {
+      {"context", {
+        {"hardware_concurrency", std::thread::hardware_concurrency()},
+        {"samples", opts.samples},
+        {"min_time", opts.minTime}
+      }},
+      {"benchmarks", results}
+    };
+  }
+
+private:
+  static double time(const std::function<void()>& op, std::uint64_t iters) {
+    const auto start = Clock::now();
+    for(std::uint64_t i = 0; i < iters; i++) op();
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  const Options opts;
+  nlohmann::json results = nlohmann::json::array();
+};
+
+Seed
+makeSeed() {
+  unsigned char raw[32];
+  for(int i = 0; i < 32; i++) raw[i] = (unsigned char)(i * 37 + 11);
+  return Seed({EVP_SKEY_import_raw_key(NULL, NULL, raw, sizeof(raw), NULL),
+    &EVP_SKEY_free});
+}
+
+std::string
+makeId(std::mt19937_64& rng, std::size_t i) {
+  static const char chars[] = "abcdefghijklmnopqrstuvwxyz0123456789.-";
+  std::string id;
+  const std::size_t len = 8 + rng() % 24;
+  for(std::size_t j = 0; j < len; j++)
+    id += chars[rng() % (sizeof(chars) - 1)];
+  return id + "#" + std::to_string(i);
+}
+
+void
+fillVault(Genpass& genpass, std::size_t n) {
+  std::mt19937_64 rng(n);
+  for(std::size_t i = 0; i < n; i++) {
+    auto& pw = static_cast<PasswordV2&>(
+      genpass.newPassword("genpass-2.0", makeId(rng, i)));
+    pw.serial = (std::int32_t)(rng() % 4);
+    pw.note = rng() % 4 ? "" : "synthetic entry";
+    PolicyRules rules;
+    if(rng() % 2) rules.bannedChars = {'+', '/', '='};
+    rules.length = 16 + rng() % 48;
+    pw.policy = Policy::intern(rules);
+  }
+}
+
+// Writes a seed file in the "Salted__" format that Seed::writeEncryptedFile
+// has replaced, but Seed::fromEncryptedFile still reads.
+void
+writeLegacySeedFile(const std::filesystem::path& file, const std::string& password) {
+  const unsigned char salt[PKCS5_SALT_LEN] = {1, 2, 3, 4, 5, 6, 7, 8};
+  unsigned int iter = 1 << 13;
+  unsigned char key[32];
+
+  EVP_KDF *kdfAlg = EVP_KDF_fetch(NULL, "PBKDF2", NULL);
+  EVP_KDF_CTX *kdf = kdfAlg ? EVP_KDF_CTX_new(kdfAlg) : NULL;
+  OSSL_PARAM params[] = {
+    {OSSL_KDF_PARAM_PASSWORD, OSSL_PARAM_OCTET_STRING,
+      const_cast<char *>(password.data()), password.length(), 0},
+    {OSSL_KDF_PARAM_SALT, OSSL_PARAM_OCTET_STRING,
+      const_cast<unsigned char *>(salt), sizeof(salt), 0},
+    {OSSL_KDF_PARAM_ITER, OSSL_PARAM_UNSIGNED_INTEGER, &iter, sizeof(iter), 0},
+    {NULL, 0, NULL, 0, 0}
+  };
+  const bool derived = kdf && EVP_KDF_derive(kdf, key, sizeof(key), params);
+  EVP_KDF_CTX_free(kdf);
+  EVP_KDF_free(kdfAlg);
+  if(!derived) throw std::runtime_error("failed to derive key");
+
+  unsigned char seed[32], enc[48];
+  for(int i = 0; i < 32; i++) seed[i] = (unsigned char)(i * 13);
+  int len1, len2;
+  EVP_CIPHER_CTX *cipher = EVP_CIPHER_CTX_new();
+  const bool encrypted = cipher
+    && EVP_EncryptInit_ex2(cipher, EVP_aes_256_ecb(), key, NULL, NULL)
+    && EVP_EncryptUpdate(cipher, enc, &len1, seed, sizeof(seed))
+    && EVP_EncryptFinal_ex(cipher, enc + len1, &len2);
+  EVP_CIPHER_CTX_free(cipher);
+  if(!encrypted || len1 + len2 != sizeof(enc))
+    throw std::runtime_error("failed to encrypt seed");
+
+  std::ofstream out(file, std::ios::binary);
+  out.write("Salted__", 8);
+  out.write((const char *)salt, sizeof(salt));
+  out.write((const char *)enc, sizeof(enc));
+}
+
+void
+benchGenerate(Runner& runner, const Seed& seed) {
+  PasswordV2 pw("example.com");
+
+  runner.run("PasswordV2::generate", {}, [&] {
+    doNotOptimize(pw.generate(seed));
+  });
+
+  const Seed::EVP_MAC_CTX_ptr mac = seed.newMac();
+  runner.run("PasswordV2::generate/reused-mac", {}, [&] {
+    doNotOptimize(pw.generate(seed, mac.get()));
+  });
+
+  char buf[64];
+  runner.run("PasswordV2::generateInto", {}, [&] {
+    pw.generateInto(seed, mac.get(), buf);
+    doNotOptimize(buf);
+  });
+
+  // V2 pads anything past its 44 chars of MAC, while V3 draws as much
+  // keystream as the length needs
+  for(const std::size_t length : {16, 44, 128}) {
+    PasswordV2 v2("example.com");
+    PolicyRules rules;
+    rules.length = length;
+    v2.policy = Policy::intern(rules);
+    runner.run("PasswordV2::generate", {{"length", length}}, [&] {
+      doNotOptimize(v2.generate(seed, mac.get()));
+    });
+
+    PasswordV3 v3("example.com");
+    v3.length = length;
+    runner.run("PasswordV3::generate", {{"length", length}}, [&] {
+      doNotOptimize(v3.generate(seed, mac.get()));
+    });
+  }
+}
+
+void
+benchPrepare(Runner& runner) {
+  const std::string base = "q3Zp+V0/aXbE1lU9rT2kYcHn8wG4sJ7mDfLo6iNuK5e=";
+  const std::vector<std::pair<std::string, std::unordered_set<char>>> bans = {
+    {"none", {}},
+    {"base64-symbols", {'+', '/', '='}},
+    {"ambiguous", {'+', '/', '=', '0', 'O', 'o', 'I', 'l', '1', 'i', 'j',
+      'S', '5', 'Z', '2', 'B', '8', 'G', '6', 'q'}}
+  };
+
+  for(const auto& [banName, banned] : bans) {
+    for(const std::size_t length : {16, 48, 128}) {
+      PasswordV2 pw("example.com");
+      PolicyRules rules;
+      rules.bannedChars = banned;
+      rules.length = length;
+      pw.policy = Policy::intern(rules);
+      runner.run("PasswordV2::prepare",
+        {{"bannedChars", banName}, {"length", length}},
+        [&] { doNotOptimize(pw.prepare(base)); });
+    }
+  }
+}
+
+void
+benchCharClass(Runner& runner) {
+  std::mt19937_64 rng(1);
+  std::string text(4096, '\0');
+  for(char& c : text) c = CharClass::base64[rng() % CharClass::base64.size()];
+
+  runner.run("CharClass::span", {{"bytes", text.size()}}, [&] {
+    doNotOptimize(CharClass::base64.span(text));
+  });
+  runner.run("CharClass::countIn", {{"bytes", text.size()}}, [&] {
+    doNotOptimize(CharClass::digit.countIn(text));
+  });
+  std::string out(text.size(), '\0');
+  runner.run("CharClass::copyWithout", {{"bytes", text.size()}}, [&] {
+    doNotOptimize(CharClass::digit.copyWithout(text, out.data(), out.size()));
+  });
+}
+
+void
+benchBatch(Runner& runner, const Seed& seed) {
+  Genpass genpass;
+  fillVault(genpass, 10000);
+  for(const unsigned threads : {1u, 0u}) {
+    genpass.setThreadCount(threads);
+    runner.run("Genpass::generateAll",
+      {{"entries", 10000}, {"threads", threads}},
+      [&] { doNotOptimize(genpass.generateAll(seed)); });
+  }
+
+  // the plain and the secure results, without the sort of generateAll
+  std::vector<const Password *> batch;
+  for(auto it = genpass.passwords_cbegin(); it != genpass.passwords_cend();
+      ++it)
+    batch.push_back(&*it);
+  genpass.setThreadCount(1);
+  runner.run("Genpass::generate", {{"entries", 10000}, {"threads", 1}},
+    [&] { doNotOptimize(genpass.generate(seed, batch)); });
+  runner.run("Genpass::generateSecure", {{"entries", 10000}, {"threads", 1}},
+    [&] { doNotOptimize(genpass.generateSecure(seed, batch)); });
+}
+
+void
+benchVault(Runner& runner) {
+  for(const std::size_t n : {1000, 10000, 100000}) {
+    Genpass genpass;
+    fillVault(genpass, n);
+
+    runner.run("Genpass::serialize", {{"entries", n}}, [&] {
+      doNotOptimize(genpass.serialize().dump());
+    });
+    runner.run("Genpass::serializeTo", {{"entries", n}}, [&] {
+      std::ostringstream out;
+      genpass.serializeTo(out);
+      doNotOptimize(out);
+    });
+
+    // look the IDs up in a shuffled order, so consecutive lookups don't
+    // share cache lines
+    std::vector<std::string> ids;
+    for(auto it = genpass.passwords_cbegin(); it != genpass.passwords_cend();
+        ++it)
+      ids.push_back(it->id);
+    std::shuffle(ids.begin(), ids.end(), std::mt19937_64(n));
+    std::size_t next = 0;
+    runner.run("Genpass::getPassword", {{"entries", n}}, [&] {
+      doNotOptimize(genpass.getPassword(ids[next]));
+      if(++next == ids.size()) next = 0;
+    });
+
+    const std::string text = genpass.serialize().dump();
+    runner.run("Genpass::deserialize",
+      {{"entries", n}, {"bytes", text.size()}},
+      [&] {
+        Genpass loaded;
+        loaded.deserialize(text);
+        doNotOptimize(loaded);
+      }
+    );
+    // the same from a parsed document, so parsing is not timed (copying it
+    // is)
+    const nlohmann::json dom = nlohmann::json::parse(text);
+    for(const unsigned threads : {1u, 0u}) {
+      runner.run("Genpass::deserialize",
+        {{"entries", n}, {"format", "dom"}, {"threads", threads}},
+        [&] {
+          Genpass loaded;
+          loaded.setThreadCount(threads);
+          loaded.deserialize(nlohmann::json(dom));
+          doNotOptimize(loaded);
+        }
+      );
+    }
+
+    for(const VaultFormat format :
+        {VaultFormat::cbor, VaultFormat::msgpack, VaultFormat::bson}) {
+      std::ostringstream out;
+      genpass.serializeTo(out, format);
+      const std::string encoded = out.str();
+      runner.run("Genpass::deserialize",
+        {{"entries", n}, {"bytes", encoded.size()},
+          {"format", vaultFormatName(format)}},
+        [&] {
+          Genpass loaded;
+          loaded.deserialize(encoded, format);
+          doNotOptimize(loaded);
+        }
+      );
+    }
+
+#ifndef _WIN32
+    // opening a binary vault and reading one entry, versus parsing all of it
+    const std::filesystem::path file =
+      std::filesystem::temp_directory_path() / "genpass_bench.gpv";
+    VaultFile::write(genpass, file);
+    runner.run("VaultFile::getPassword", {{"entries", n}}, [&] {
+      VaultFile vault(file);
+      doNotOptimize(vault.getPassword(vault.idAt(n / 2)));
+    });
+    std::filesystem::remove(file);
+#endif
+  }
+}
+
+void
+benchSearch(Runner& runner) {
+  const std::size_t n = 100000;
+  Genpass genpass;
+  fillVault(genpass, n);
+
+  std::vector<std::string> queries;
+  for(auto it = genpass.passwords_cbegin(); it != genpass.passwords_cend();
+      ++it) {
+    if(queries.size() == 256) break;
+    queries.push_back(it->id);
+  }
+  // build the index up front, so that it isn't counted in the first sample
+  for(Password& password : genpass.findByPrefix(queries[0])) (void)password;
+
+  const auto count = [](detail::PasswordRange range) {
+    std::size_t ret = 0;
+    for(Password& password : range) ret += !password.id.empty();
+    return ret;
+  };
+  std::size_t next = 0;
+  const auto query = [&]() -> const std::string& {
+    const std::string& ret = queries[next];
+    if(++next == queries.size()) next = 0;
+    return ret;
+  };
+
+  runner.run("Genpass::findByPrefix", {{"entries", n}, {"length", 3}}, [&] {
+    doNotOptimize(count(genpass.findByPrefix(query().substr(0, 3))));
+  });
+  runner.run("Genpass::findBySubstring", {{"entries", n}, {"length", 4}},
+    [&] {
+      doNotOptimize(count(genpass.findBySubstring(query().substr(2, 4))));
+    });
+  for(const unsigned edits : {1u, 2u}) {
+    runner.run("Genpass::findFuzzy", {{"entries", n}, {"edits", edits}}, [&] {
+      doNotOptimize(count(genpass.findFuzzy(query(), edits)));
+    });
+  }
+}
+
+void
+benchReverseIndex(Runner& runner, const Seed& seed) {
+  const std::size_t n = 10000;
+  const std::int32_t serials = 4;
+  Genpass genpass;
+  fillVault(genpass, n);
+
+  runner.run("Genpass::reverseIndex", {{"entries", n}, {"serials", serials}},
+    [&] {
+      doNotOptimize(genpass.reverseIndex(seed, 0, serials - 1));
+    });
+
+  // half the queries hit, half miss
+  const ReverseIndex index = genpass.reverseIndex(seed, 0, serials - 1);
+  std::vector<std::string> queries;
+  for(const auto& [id, password] : genpass.generateAll(seed)) {
+    queries.push_back(password);
+    queries.push_back(password + "!");
+  }
+  std::size_t next = 0;
+  runner.run("ReverseIndex::find", {{"entries", n}, {"serials", serials}},
+    [&] {
+      doNotOptimize(index.find(queries[next]));
+      if(++next == queries.size()) next = 0;
+    });
+}
+
+void
+benchDerive(Runner& runner, const Seed& seed) {
+  runner.run("Seed::derive", {{"cached", true}}, [&] {
+    doNotOptimize(seed.derive("tenant"));
+  });
+  // labels cycle through twice the cache size, so that every one misses
+  std::size_t next = 0;
+  runner.run("Seed::derive", {{"cached", false}}, [&] {
+    doNotOptimize(seed.derive(std::to_string(next++ % 128)));
+  });
+}
+
+// A burst of requests, as from an event loop, against the same entries done
+// synchronously.
+void
+benchAsync(Runner& runner, const Seed& seed) {
+  const std::size_t n = 256;
+  Genpass genpass;
+  fillVault(genpass, n);
+  genpass.publish();
+  const std::shared_ptr<const Snapshot> snapshot = genpass.getSnapshot();
+  std::vector<std::shared_ptr<const Password>> passwords;
+  for(auto it = snapshot->passwords_cbegin(); it != snapshot->passwords_cend();
+      ++it)
+    passwords.emplace_back(snapshot, &*it);
+  const std::shared_ptr<const Seed> child = seed.derive("async");
+
+  runner.run("Password::generate", {{"requests", n}}, [&] {
+    for(const auto& password : passwords)
+      doNotOptimize(password->generate(*child));
+  });
+  for(const unsigned threads : {1u, 0u}) {
+    AsyncGenerator generator(threads);
+    std::vector<std::future<std::string>> results;
+    runner.run("AsyncGenerator::generate",
+      {{"requests", n}, {"threads", generator.getThreadCount()}}, [&] {
+        for(const auto& password : passwords)
+          results.push_back(generator.generate(child, password));
+        for(auto& result : results) doNotOptimize(result.get());
+        results.clear();
+      });
+  }
+}
+
+void
+benchSeedFile(Runner& runner) {
+  const std::filesystem::path file =
+    std::filesystem::temp_directory_path() / "genpass_bench.seed";
+  const std::string password = "correct horse battery staple";
+  writeLegacySeedFile(file, password);
+
+  runner.run("Seed::fromEncryptedFile", {{"kdf", "legacy"}}, [&] {
+    doNotOptimize(Seed::fromEncryptedFile(file, password));
+  });
+
+  const Seed seed = Seed::fromEncryptedFile(file, password);
+  const std::pair<const char *, SeedKdfParams> kdfs[] = {
+    {"pbkdf2", {SeedKdf::pbkdf2, 1 << 13, 0, 1}},
+    {"scrypt", {SeedKdf::scrypt, 0, 1 << 14, 1}},
+    {"argon2id", {SeedKdf::argon2id, 2, 1 << 14, 1}},
+  };
+  for(const auto& [name, params] : kdfs) {
+    seed.writeEncryptedFile(file, password, params);
+    runner.run("Seed::fromEncryptedFile",
+      {{"kdf", name}, {"iterations", params.iterations},
+        {"memoryKiB", params.memoryKiB}},
+      [&] {
+        doNotOptimize(Seed::fromEncryptedFile(file, password));
+      });
+  }
+
+  std::filesystem::remove(file);
+}
+
+Options
+parseArgs(int argc, char **argv) {
+  Options opts;
+  for(int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    const auto value = [&](const char *flag) -> const char * {
+      const std::size_t len = std::strlen(flag);
+      return arg.compare(0, len, flag) ? nullptr : argv[i] + len;
+    };
+    if(const char *v = value("--filter=")) opts.filter = v;
+    else if(const char *v = value("--samples=")) opts.samples = std::stoul(v);
+    else if(const char *v = value("--min-time=")) opts.minTime = std::stod(v);
+    else if(const char *v = value("--out=")) opts.out = v;
+    else throw std::invalid_argument("unknown argument: " + arg);
+  }
+  if(!opts.samples) throw std::invalid_argument("need at least one sample");
+  return opts;
+}
+
+} // namespace
+
+int
+main(int argc, char **argv) {
+  try {
+    const Options opts = parseArgs(argc, argv);
+    Runner runner(opts);
+    const Seed seed = makeSeed();
+
+    benchGenerate(runner, seed);
+    benchPrepare(runner);
+    benchCharClass(runner);
+    benchBatch(runner, seed);
+    benchVault(runner);
+    benchSearch(runner);
+    benchReverseIndex(runner, seed);
+    benchDerive(runner, seed);
+    benchAsync(runner, seed);
+    benchSeedFile(runner);
+
+    nlohmann::json reportJson = runner.report();
+    // totals over every run, warmups included
+    if(metricsEnabled) reportJson["metrics"] = metricsSnapshot().toJson();
+    const std::string report = reportJson.dump(2);
+    if(opts.out.empty()) {
+      std::cout << report << std::endl;
+    } else {
+      std::ofstream out(opts.out);
+      out.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+      out << report << std::endl;
+    }
+  } catch(const std::exception& e) {
+    fmt::println(stderr, "error: {}", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,114 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/Agent.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_AGENT_HPP__
+#define __GENPASS_AGENT_HPP__
+
+#include <nlohmann/json_fwd.hpp>  // for json
+#include <atomic>                 // for atomic
+#include <filesystem>             // for path
+#include <mutex>                  // for mutex
+#include <string>                 // for string
+#include <utility>                // for pair
+#include <vector>                 // for vector
+
+#include "genpass/Genpass.hpp"            // for Genpass
+#include "genpass/Password.hpp"           // for Password
+#include "genpass/Seed.hpp"               // for Seed
+
+namespace genpass {
+
+// The socket to use if none is given: $GENPASS_AGENT_SOCK if set, otherwise
+// genpass-agent.sock in $XDG_RUNTIME_DIR, otherwise agent.sock in
+// /tmp/genpass-<uid>. Whichever it is, the directory holding the socket must
+// belong to the user and not be writable by anyone else.
+std::filesystem::path defaultAgentSocket();
+
+// Serves password generation with an unlocked seed over a Unix domain
+// socket, so that the seed file only has to be unlocked once per session.
+// Only processes of the same user may connect. The socket's directory is
+// created with mode 0700 if it doesn't exist. Clients are served
+// concurrently, each on its own thread.
+//
+// Messages in both directions are a 32-bit little-endian length followed
+// by that many bytes of JSON. A request is either
+//   {"op": "generate", "passwords": [<serialized password>...]}
+// which is answered with {"passwords": [<generated password>...]}, or
+//   {"op": "stop"}
+// which shuts the agent down. Failures are answered with {"error": "..."}.
+class AgentServer {
+public:
+  AgentServer(const Seed& seed, const std::filesystem::path& socket);
+  AgentServer(const AgentServer&) = delete;
+  ~AgentServer();
+
+  // Accepts and serves clients until stop() is called or a client sends
+  // a stop request, then waits for the connected clients to finish.
+  void serve();
+  void stop();
+
+  // The registry used to load passwords sent by clients. Register any
+  // extra algorithms here before calling serve().
+  Genpass& getGenpass() { return genpass; }
+
+private:
+  void serveClient(int fd);
+  nlohmann::json handle(const nlohmann::json& request);
+
+  const Seed& seed;
+  Genpass genpass;
+  const std::filesystem::path socketPath;
+  int listenFd;
+  std::atomic<bool> stopping;
+  std::mutex handleMutex;
+};
+
+// Generates passwords through a running AgentServer instead of a Seed.
+// Connecting fails if the agent is run by another user.
+class AgentClient {
+public:
+  explicit AgentClient(
+    const std::filesystem::path& socket = defaultAgentSocket());
+  AgentClient(const AgentClient&) = delete;
+  ~AgentClient();
+
+  std::string generate(const Password& password);
+  // Generates a whole batch in one round trip; results are in input order.
+  std::vector<std::string> generate(
+    const std::vector<const Password *>& passwords);
+  // Same as Genpass::generate and Genpass::generateAll, but with the seed
+  // held by the agent.
+  std::vector<std::string> generate(const Genpass& genpass,
+    const std::vector<std::string>& ids);
+  std::vector<std::pair<std::string, std::string>>
+  generateAll(const Genpass& genpass);
+
+  // Asks the agent to forget the seed and exit.
+  void stopAgent();
+
+private:
+  nlohmann::json request(const nlohmann::json& req);
+
+  int fd;
+};
+
+} // namespace genpass
+
+#endif // __GENPASS_AGENT_HPP__
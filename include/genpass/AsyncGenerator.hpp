@@ -0,0 +1,110 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/AsyncGenerator.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_ASYNCGENERATOR_HPP__
+#define __GENPASS_ASYNCGENERATOR_HPP__
+
+#include <condition_variable>  // for condition_variable
+#include <cstddef>             // for size_t
+#include <deque>               // for deque
+#include <exception>           // for exception_ptr
+#include <filesystem>          // for path
+#include <functional>          // for function
+#include <future>              // for future
+#include <memory>              // for shared_ptr
+#include <mutex>               // for mutex
+#include <string>              // for string
+#include <thread>              // for jthread
+#include <vector>              // for vector
+
+#include "genpass/Password.hpp"  // for Password
+#include "genpass/Seed.hpp"      // for Seed
+
+namespace genpass {
+
+// Runs generation and seed unlocking on a pool of worker threads, so that an
+// event loop never blocks on OpenSSL. Requests are queued and return at
+// once; their results come back either through a future or through a
+// callback, which runs on a worker thread and would typically post the
+// result to the loop.
+//
+// Generate requests that are queued together are taken by a worker in one
+// go and generated as a batch per seed, which lets plain PasswordV2
+// entries share the multi-buffer HMAC.
+//
+// Requests hold shared references to their seed and password, so neither
+// may be changed until the request has completed. A password of a Snapshot
+// can be passed as an aliasing shared_ptr that keeps the Snapshot alive, and
+// Seed::derive children are already shared. The destructor completes every
+// queued request before it returns.
+class AsyncGenerator {
+public:
+  // Called with the result, or with the exception that prevented it. Must
+  // not throw.
+  using GenerateCallback =
+    std::function<void(std::string&& password, std::exception_ptr error)>;
+  using SeedCallback = std::function<void(
+    std::shared_ptr<const Seed>&& seed, std::exception_ptr error)>;
+
+  // Zero threads means one per hardware thread.
+  explicit AsyncGenerator(unsigned threads = 0);
+  AsyncGenerator(const AsyncGenerator&) = delete;
+  ~AsyncGenerator();
+
+  // Throw std::invalid_argument at once if any argument is null.
+  std::future<std::string> generate(std::shared_ptr<const Seed> seed,
+    std::shared_ptr<const Password> password);
+  void generate(std::shared_ptr<const Seed> seed,
+    std::shared_ptr<const Password> password, GenerateCallback done);
+
+  // Seed::fromEncryptedFile, on a worker. The request's copy of `password`
+  // is only ever held in a SecureString, which wipes it when the request
+  // is done.
+  std::future<std::shared_ptr<const Seed>> loadSeed(
+    const std::filesystem::path& file, const std::string& password);
+  void loadSeed(const std::filesystem::path& file,
+    const std::string& password, SeedCallback done);
+
+  unsigned getThreadCount() const { return workers.size(); }
+
+private:
+  struct Request {
+    std::shared_ptr<const Seed> seed;
+    std::shared_ptr<const Password> password;
+    GenerateCallback done;
+  };
+
+  void submit(std::function<void()>&& task);
+  void work();
+  static void runBatch(std::vector<Request>& batch);
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<Request> requests;
+  // work other than generation, such as unlocking seeds
+  std::deque<std::function<void()>> tasks;
+  bool stopping = false;
+  // last, so that the workers start after the rest is constructed
+  std::vector<std::jthread> workers;
+};
+
+} // namespace genpass
+
+#endif // __GENPASS_ASYNCGENERATOR_HPP__
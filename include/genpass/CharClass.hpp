@@ -21,27 +21,133 @@
 #ifndef __GENPASS_CHARCLASS_HPP__
 #define __GENPASS_CHARCLASS_HPP__
 
+#include <cstddef>           // for size_t
+#include <cstdint>           // for uint64_t, uint8_t, uint16_t
+#include <initializer_list>  // for initializer_list
+#include <string>            // for string
+#include <string_view>       // for string_view
+
 namespace genpass {
 
+// A set of chars that a password may draw from, as a 256-bit bitmap plus
+// the dense table of its members in ascending (unsigned) order, so that
+// both membership and picking the i-th member are a single lookup. Classes
+// are immutable and can be built at compile time.
 class CharClass {
 public:
-  CharClass();
-  CharClass(std::initializer_list<char>);
-  CharClass(std::string)
+  constexpr CharClass() : bits{}, symbols{}, count(0), nibbles{} { }
+  constexpr CharClass(std::initializer_list<char> chars) : CharClass() {
+    for(const char c : chars) set(c);
+    finish();
+  }
+  constexpr CharClass(std::string_view chars) : CharClass() {
+    for(const char c : chars) set(c);
+    finish();
+  }
+  // All chars from `first` to `last`, inclusive.
+  static constexpr CharClass range(char first, char last) {
+    CharClass ret;
+    for(unsigned c = (unsigned char)first; c <= (unsigned char)last; c++)
+      ret.set((char)c);
+    ret.finish();
+    return ret;
+  }
 
-  std::unordered_set<char> chars;
-  char default_;
+  constexpr bool contains(char c) const {
+    const unsigned char u = c;
+    return (bits[u >> 6] >> (u & 63)) & 1;
+  }
+  constexpr std::size_t size() const { return count; }
+  constexpr bool empty() const { return !count; }
+  // The i-th member in ascending order, for i < size().
+  constexpr char operator[](std::size_t i) const { return symbols[i]; }
+  // The smallest member, or '\0' if the class is empty.
+  constexpr char defaultChar() const { return count ? symbols[0] : '\0'; }
+  // The members in ascending order, e.g. for serialization.
+  std::string str() const { return std::string(symbols, count); }
 
-public:
+  constexpr CharClass operator|(const CharClass& other) const {
+    return combine(other, [](std::uint64_t a, std::uint64_t b) { return a | b; });
+  }
+  constexpr CharClass operator&(const CharClass& other) const {
+    return combine(other, [](std::uint64_t a, std::uint64_t b) { return a & b; });
+  }
+  constexpr CharClass operator-(const CharClass& other) const {
+    return combine(other, [](std::uint64_t a, std::uint64_t b) { return a & ~b; });
+  }
+
+  friend constexpr bool operator==(const CharClass& a, const CharClass& b) {
+    for(int i = 0; i < 4; i++)
+      if(a.bits[i] != b.bits[i]) return false;
+    return true;
+  }
+
+  // Bulk tests, 32 chars at a time with AVX2 where the CPU has it.
+  //
+  // The number of chars of `s` that are members.
+  std::size_t countIn(std::string_view s) const;
+  // The index of the first char of `s` that is not a member, or s.size().
+  std::size_t span(std::string_view s) const;
+  // Copies the chars of `in` that are not members to `out`, up to `cap` of
+  // them. Returns the number copied.
+  std::size_t copyWithout(std::string_view in, char *out,
+    std::size_t cap) const;
+
+  // printable ASCII, not including space
   static const CharClass ascii;
   static const CharClass base64;
   static const CharClass alpha;
   static const CharClass lowercase;
   static const CharClass uppercase;
   static const CharClass digit;
+  // printable ASCII that is neither a letter, a digit nor a space
   static const CharClass special;
+
+private:
+  constexpr void set(char c) {
+    const unsigned char u = c;
+    bits[u >> 6] |= std::uint64_t(1) << (u & 63);
+  }
+
+  // Builds the member table and the nibble tables from the bitmap.
+  constexpr void finish() {
+    count = 0;
+    for(unsigned c = 0; c < 256; c++) {
+      if(!contains((char)c)) continue;
+      symbols[count++] = (char)c;
+      nibbles[c >> 7][c & 15] |= 1 << ((c >> 4) & 7);
+    }
+  }
+
+  template<typename Op>
+  constexpr CharClass combine(const CharClass& other, Op op) const {
+    CharClass ret;
+    for(int i = 0; i < 4; i++) ret.bits[i] = op(bits[i], other.bits[i]);
+    ret.finish();
+    return ret;
+  }
+
+  friend struct CharClassKernels;
+
+  std::uint64_t bits[4];
+  char symbols[256];
+  std::uint16_t count;
+  // for the vectorized tests: bit (c >> 4 & 7) of nibbles[c >> 7][c & 15]
+  // is set if c is a member
+  std::uint8_t nibbles[2][16];
 };
 
+inline constexpr CharClass CharClass::ascii = CharClass::range('!', '~');
+inline constexpr CharClass CharClass::lowercase = CharClass::range('a', 'z');
+inline constexpr CharClass CharClass::uppercase = CharClass::range('A', 'Z');
+inline constexpr CharClass CharClass::digit = CharClass::range('0', '9');
+inline constexpr CharClass CharClass::alpha =
+  CharClass::lowercase | CharClass::uppercase;
+inline constexpr CharClass CharClass::base64 =
+  CharClass::alpha | CharClass::digit | CharClass("+/");
+inline constexpr CharClass CharClass::special =
+  CharClass::ascii - CharClass::alpha - CharClass::digit;
+
 } // namespace genpass
 
 #endif // __GENPASS_CHARCLASS_HPP__
@@ -23,59 +23,296 @@
 
 #include <nlohmann/json.hpp>      // for basic_json
 #include <nlohmann/json_fwd.hpp>  // for json
+#include <atomic>                 // for atomic
+#include <cstddef>                // for NULL
+#include <cstdint>                // for int32_t, uint64_t
+#include <deque>                  // for deque
+#include <filesystem>             // for path
 #include <functional>             // for function
+#include <iosfwd>                 // for ostream
 #include <map>                    // for operator==
-#include <memory>                 // for unique_ptr
+#include <memory>                 // for unique_ptr, shared_ptr
+#include <memory_resource>        // for memory_resource, monotonic_buffer...
+#include <mutex>                  // for once_flag
+#include <new>                    // for operator new
 #include <string>                 // for string, hash, basic_string
+#include <string_view>            // for string_view
 #include <unordered_map>          // for unordered_map
+#include <unordered_set>          // for unordered_set
+#include <utility>                // for forward, pair
+#include <vector>                 // for vector
 
 #include "genpass/Password.hpp"           // for Password
+#include "genpass/ReverseIndex.hpp"       // for ReverseIndex
+#include "genpass/SecureString.hpp"       // for SecureString
+#include "genpass/Seed.hpp"               // for Seed
+#include "genpass/Snapshot.hpp"           // for Snapshot
+#include "genpass/VaultFormat.hpp"        // for VaultFormat
 #include "genpass/detail/IndirectIterator.hpp"
+#include "genpass/detail/PasswordRange.hpp"  // for PasswordRange
+#include "genpass/detail/PasswordTable.hpp"  // for PasswordTable
+#include "genpass/detail/VaultLoader.hpp"  // for VaultLoader
 
 namespace genpass {
 
+class Journal;
+namespace detail { class IdIndex; }
+
+// Told about every change made to the passwords of a Genpass, after it has
+// been made. See Genpass::setListener.
+class PasswordListener {
+public:
+  virtual ~PasswordListener() = default;
+
+  // A password was added, or marked as modified.
+  virtual void passwordPut(const Password& password) = 0;
+  virtual void passwordRemoved(const std::string& id) = 0;
+  // Passwords previously stored under the given old IDs are now under their
+  // own IDs. The renames happened at once, so IDs may have been swapped.
+  virtual void passwordsRenamed(
+    const std::vector<std::pair<std::string, const Password *>>& renames) = 0;
+  virtual void passwordsCleared() = 0;
+  // Stale passwords were moved to their current IDs by updateAllIds. Their
+  // previous IDs are not known.
+  virtual void passwordsReindexed() = 0;
+  // Passwords were added by deserialize or loadFrom, which does not report
+  // them one by one. A load that failed part way may have added some.
+  virtual void passwordsLoaded() = 0;
+};
+
 class Genpass {
+  friend class detail::VaultLoader;
+  friend class Journal;
+
 private:
-  std::unordered_map<std::string, std::unique_ptr<Password>> passwords;
-  std::unordered_map<std::string, std::function<Password *()>> algorithms;
+  struct Algorithm {
+    // constructs a password on the heap
+    std::function<Password *()> create;
+    // constructs a password in an arena; NULL if the algorithm can't
+    Password *(*emplace)(std::pmr::memory_resource& arena);
+  };
+
+  // Passwords are constructed in the arena when their algorithm allows it,
+  // and on the heap otherwise (see heapOwned). Arena memory is reclaimed by
+  // clearPasswords or when the Genpass is destroyed.
+  std::pmr::monotonic_buffer_resource arena;
+  // used by the extra workers of a parallel load, one each
+  std::deque<std::pmr::monotonic_buffer_resource> workerArenas;
+  detail::PasswordTable passwords;
+  std::unordered_set<const Password *> heapOwned;
+  std::unordered_map<std::string, Algorithm> algorithms;
+  unsigned threadCount = 0;
+  PasswordListener *listener = NULL;
+  // set while a vault is loaded, so that passwordPut isn't called for each
+  // password
+  bool loading = false;
+  // built by the first search, then kept up to date
+  mutable std::unique_ptr<detail::IdIndex> index;
+  mutable std::once_flag indexBuilt;
+  // the latest version published, and the copies in it of the passwords
+  // that have not changed since
+  std::atomic<std::shared_ptr<const Snapshot>> snapshot;
+  std::unordered_map<const Password *, std::shared_ptr<const Password>>
+    published;
+  std::uint64_t snapshotVersion = 0;
 
 public:
   using PasswordIterator = detail::IndirectIterator<
-    Password, decltype(passwords)::iterator,
-    [](const auto& it) -> Password * { return it->second.get(); }
+    Password, detail::PasswordTable::iterator,
+    [](const auto& it) -> Password * { return *it; }
   >;
   using ConstPasswordIterator = detail::IndirectIterator<
-    const Password, decltype(passwords)::const_iterator,
-    [](const auto& it) -> const Password * { return it->second.get(); }
+    const Password, detail::PasswordTable::iterator,
+    [](const auto& it) -> const Password * { return *it; }
   >;
 
   Genpass();
+  Genpass(const Genpass&) = delete;
   ~Genpass();
 
   Password& addPassword(std::unique_ptr<Password>&& password);
   Password& newPassword(const std::string& algorithm, const std::string& id);
-  Password& getPassword(const std::string& id) const;
-  void removePassword(const std::string& id);
+  // Throws std::out_of_range if there is no password with `id`.
+  Password& getPassword(std::string_view id) const;
+  // Returns NULL if there is no password with `id`.
+  Password *findPassword(std::string_view id) const;
+  void removePassword(std::string_view id);
+  std::size_t passwordCount() const { return passwords.size(); }
+
+  // Searches of the password IDs. The first search builds an index, which
+  // is then maintained by every change. The ranges are lazy, and are
+  // invalidated by any change to the passwords.
+  //
+  // Passwords whose IDs start with `prefix`, ordered by ID.
+  detail::PasswordRange findByPrefix(std::string_view prefix) const;
+  // Passwords whose IDs contain `needle`, in no particular order.
+  detail::PasswordRange findBySubstring(std::string_view needle) const;
+  // Passwords whose IDs are within `maxEdits` insertions, deletions and
+  // substitutions of `id`, ordered by ID.
+  detail::PasswordRange findFuzzy(std::string_view id,
+    unsigned maxEdits) const;
 
   PasswordIterator passwords_begin() { return passwords.begin(); }
   PasswordIterator passwords_end() { return passwords.end(); }
-  ConstPasswordIterator passwords_cbegin() const { return passwords.cbegin(); }
-  ConstPasswordIterator passwords_cend() const { return passwords.cend(); }
+  ConstPasswordIterator passwords_cbegin() const { return passwords.begin(); }
+  ConstPasswordIterator passwords_cend() const { return passwords.end(); }
+
+  // Generates the passwords for `ids` on up to getThreadCount() threads.
+  // The results are in the same order as `ids`.
+  std::vector<std::string> generate(const Seed& seed,
+    const std::vector<std::string>& ids) const;
+  // Same, for passwords that need not be in this Genpass.
+  std::vector<std::string> generate(const Seed& seed,
+    const std::vector<const Password *>& batch) const;
+  // Same as both of the above, with each password only ever held in secure
+  // memory, from which it is wiped when its SecureString goes.
+  std::vector<SecureString> generateSecure(const Seed& seed,
+    const std::vector<std::string>& ids) const;
+  std::vector<SecureString> generateSecure(const Seed& seed,
+    const std::vector<const Password *>& batch) const;
+  // Generates every password, returning (ID, password) pairs sorted by ID.
+  std::vector<std::pair<std::string, std::string>>
+  generateAll(const Seed& seed) const;
+
+  // Indexes what every password generates at each serial from
+  // `firstSerial` to `lastSerial`, so that a generated password can be
+  // traced back to its entry. The passwords are generated in batches on
+  // getThreadCount() threads. The index is a copy; later changes to the
+  // passwords are not reflected in it. Throws std::length_error if the
+  // passwords times the serials exceed 2^28.
+  ReverseIndex reverseIndex(const Seed& seed, std::int32_t firstSerial,
+    std::int32_t lastSerial) const;
+
+  // Number of worker threads used by batch operations and by loading large
+  // vaults. Zero (the default) means one per hardware thread; one makes
+  // loading sequential. Loading builds passwords on several threads at
+  // once, so the constructors and deserialize of registered algorithms
+  // must be thread-safe, as their generate already has to be.
+  unsigned getThreadCount() const { return threadCount; }
+  void setThreadCount(unsigned threads) { threadCount = threads; }
 
-  void updateId(const std::string& oldId);
+  // Moves the password stored under `oldId` to its current ID, after its
+  // `id` field has been changed. Until then, it is found by neither ID.
+  void updateId(std::string_view oldId);
+  // Same, for every password whose `id` field has changed.
   void updateAllIds();
+  // Tells the listener that fields of `password` were changed in place.
+  void markModified(const Password& password);
 
+  // A Genpass is owned by one writer thread, but any number of reader
+  // threads may work from snapshots of it at the same time. publish()
+  // makes the current passwords the snapshot returned by getSnapshot();
+  // only passwords that changed since the last publish are copied. Fields
+  // changed in place are only picked up once markModified has been called.
+  // A snapshot stays valid for as long as it is held, however many versions
+  // are published after it.
+  //
+  // Only publish() must be called by the writer thread; getSnapshot() may
+  // be called by any thread. Before the first publish, the snapshot is
+  // empty.
+  void publish();
+  std::shared_ptr<const Snapshot> getSnapshot() const {
+    return snapshot.load(std::memory_order_acquire);
+  }
+
+  PasswordListener *getListener() const { return listener; }
+  void setListener(PasswordListener *listener) { this->listener = listener; }
+
+  // Loads a vault from any input accepted by nlohmann::json::parse. The
+  // input is streamed, so only a batch of entries is held as JSON at a
+  // time; each batch is turned into passwords on getThreadCount() threads.
+  // The listener is told of the new passwords once, by passwordsLoaded.
   template<typename I>
   void deserialize(I&& in) {
-    deserialize(nlohmann::json::parse(in));
+    loadInBulk([&] {
+      detail::VaultLoader loader(*this);
+      nlohmann::json::sax_parse(std::forward<I>(in), &loader);
+      loader.finish();
+    });
   }
+  // Same, for a vault in `format`. Binary formats are streamed the same way.
+  template<typename I>
+  void deserialize(I&& in, VaultFormat format) {
+    loadInBulk([&] {
+      detail::VaultLoader loader(*this);
+      nlohmann::json::sax_parse(std::forward<I>(in), &loader,
+        detail::inputFormat(format));
+      loader.finish();
+    });
+  }
+  // Loads the vault `file`, detecting its format. Returns the format.
+  VaultFormat loadFrom(const std::filesystem::path& file);
   nlohmann::json serialize() const;
+  // Writes the same document as serialize(), but one entry at a time, so
+  // the whole vault is never held as JSON.
+  void serializeTo(std::ostream& out) const;
+  // Same, in `format`. The binary formats are built as a whole document
+  // first, so they do hold the whole vault, but with "policies" first like
+  // the JSON one, so that loading them is still streamed.
+  void serializeTo(std::ostream& out, VaultFormat format) const;
+  // Writes the vault to `file` with serializeTo. The old file is replaced
+  // atomically, so a crash mid-save cannot leave a truncated vault.
+  void saveTo(const std::filesystem::path& file,
+    VaultFormat format = VaultFormat::json) const;
   void clearPasswords();
 
+  // Constructs a password from its serialized form using the registered
+  // algorithms. Returns NULL if its algorithm is not registered.
+  std::unique_ptr<Password> constructPassword(const nlohmann::json& json) const;
+  // Same, but adds the password to this Genpass.
+  Password *loadPassword(const nlohmann::json& json);
+
+  // Registers an algorithm whose passwords are constructed on the heap.
   void registerAlgorithm(const std::string& name,
     std::function<Password *()> constructor);
+  // Registers an algorithm implemented by the default-constructible `T`,
+  // whose passwords are constructed in this Genpass's arena.
+  template<typename T>
+  void registerAlgorithm(const std::string& name) {
+    addAlgorithm(name, {
+      []() -> Password * { return new T(); },
+      [](std::pmr::memory_resource& arena) -> Password * {
+        return new(arena.allocate(sizeof(T), alignof(T))) T();
+      }
+    });
+  }
+
+private:
+  void addAlgorithm(const std::string& name, Algorithm&& algorithm);
+  Password *construct(const Algorithm& algorithm);
+  // Constructs and deserializes a password like loadPassword, but doesn't
+  // add it; the caller must insertPassword or destroy it. Returns NULL if
+  // its algorithm is not registered.
+  Password *buildPassword(const nlohmann::json& json);
+  // Takes ownership of `password` and adds it, or destroys it and throws
+  // if its ID is taken. `hash` is PasswordTable::hashId of its ID.
+  Password& insertPassword(Password *password);
+  Password& insertPassword(Password *password, std::size_t hash);
+  // Loads `entries`, completing them from the vault's `policies` if not
+  // NULL. The passwords are built on up to threadCount threads, then added
+  // in order, so the result and any exception are the same as from calling
+  // loadPassword on each. Returns false if an algorithm was unknown.
+  bool loadPasswords(nlohmann::json::array_t& entries,
+    const nlohmann::json *policies);
+  // Runs `load` with `loading` set, then calls the listener's
+  // passwordsLoaded if any passwords were added, even if `load` threw.
+  void loadInBulk(const std::function<void()>& load);
+  // Removes the password with `id` without telling the listener. Returns
+  // false if there is none.
+  bool erasePassword(std::string_view id);
+  void destroyPasswords();
+  void destroy(Password *password);
+  // The published copy of `password` is out of date.
+  void unpublish(const Password *password) {
+    if(!published.empty()) published.erase(password);
+  }
+  const detail::IdIndex& searchIndex() const;
+  static void warnUnknownAlgorithms();
 };
 
+template<>
+void Genpass::deserialize<nlohmann::json>(nlohmann::json&& in);
+
 } // namespace genpass
 
 #endif // __GENPASS_GENPASS_HPP__
@@ -0,0 +1,102 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/Journal.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_JOURNAL_HPP__
+#define __GENPASS_JOURNAL_HPP__
+
+#include <nlohmann/json_fwd.hpp>  // for json
+#include <cstddef>                // for size_t
+#include <filesystem>             // for path
+#include <string>                 // for string
+#include <utility>                // for pair
+#include <vector>                 // for vector
+
+#include "genpass/Genpass.hpp"            // for Genpass, PasswordListener
+#include "genpass/Password.hpp"           // for Password
+#include "genpass/VaultFormat.hpp"        // for VaultFormat
+
+namespace genpass {
+
+// Keeps a vault up to date by appending each change to a journal next to
+// it, instead of rewriting the whole vault. The vault keeps the VaultFormat
+// it was found in; a new one is JSON. The journal is compacted into
+// the vault once it outgrows both the vault and the compaction threshold.
+// If that fails, the change is still in the journal, so a warning is printed
+// and compaction is retried on the next append.
+//
+// The journal has one JSON record per line, which is one of
+//   {"op": "put", "password": <serialized password>}
+//   {"op": "remove", "id": "..."}
+//   {"op": "rename", "renames": [
+//     {"from": "...", "password": <serialized password>}...]}
+//   {"op": "clear"}
+// Genpass::updateAllIds compacts the journal instead, since it does not
+// know the previous IDs, and so does loading a vault into `genpass` with
+// Genpass::loadFrom or deserialize, rather than journaling each password.
+// Replaying a record twice has the same effect as replaying it once, so a
+// crash between saving the vault and emptying the journal is harmless.
+class Journal : private PasswordListener {
+public:
+  // Loads `vault` (if it exists) into `genpass`, which should be empty, and
+  // replays the journal on top. From then on, every change made through
+  // `genpass` is appended to the journal. Edits of password fields must be
+  // reported with Genpass::markModified. `genpass` must outlive the journal.
+  // Throws if a record can't be replayed, such as a password whose
+  // algorithm isn't registered, rather than dropping it.
+  Journal(Genpass& genpass, const std::filesystem::path& vault);
+  Journal(const Journal&) = delete;
+  ~Journal();
+
+  static std::filesystem::path pathFor(const std::filesystem::path& vault);
+
+  // Saves the vault with Genpass::saveTo and empties the journal.
+  void compact();
+
+  std::size_t getCompactThreshold() const { return compactThreshold; }
+  // Zero disables automatic compaction.
+  void setCompactThreshold(std::size_t bytes) { compactThreshold = bytes; }
+
+private:
+  void passwordPut(const Password& password) override;
+  void passwordRemoved(const std::string& id) override;
+  void passwordsRenamed(const std::vector<
+    std::pair<std::string, const Password *>>& renames) override;
+  void passwordsCleared() override;
+  void passwordsReindexed() override;
+  void passwordsLoaded() override;
+
+  void replay();
+  void apply(const nlohmann::json& record);
+  void put(const nlohmann::json& pwJson);
+  void append(const nlohmann::json& record);
+
+  Genpass& genpass;
+  const std::filesystem::path vaultPath;
+  const std::filesystem::path journalPath;
+  VaultFormat format;
+  int fd;
+  std::size_t journalLen;
+  std::size_t snapshotLen;
+  std::size_t compactThreshold;
+};
+
+} // namespace genpass
+
+#endif // __GENPASS_JOURNAL_HPP__
@@ -0,0 +1,67 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/Metrics.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_METRICS_HPP__
+#define __GENPASS_METRICS_HPP__
+
+#include <nlohmann/json_fwd.hpp>  // for json
+#include <cstdint>                // for uint64_t
+#include <map>                    // for map
+#include <string>                 // for string
+
+namespace genpass {
+
+// What one probe recorded since the last resetMetrics(). Timed probes add
+// the time spent in them; counting probes leave it at zero.
+struct ProbeStats {
+  std::uint64_t calls = 0;
+  std::uint64_t nanoseconds = 0;
+  std::uint64_t bytes = 0;
+};
+
+// The probes of the hot paths, by name. Timed probes are named after what
+// they time ("seed.pbkdf2", "vault.parse", "passwordV2.generate", ...),
+// counting probes after what they count ("openssl.fetch", "alloc.plan",
+// ...). Probes that never fired are left out.
+struct Metrics {
+  std::map<std::string, ProbeStats> probes;
+
+  // {"<probe>": {"calls": n, "nanoseconds": n, "bytes": n}, ...}
+  nlohmann::json toJson() const;
+};
+
+// Probes only record anything in builds configured with GENPASS_INSTRUMENT;
+// in others they compile to nothing and every snapshot is empty.
+inline constexpr bool metricsEnabled =
+#ifdef GENPASS_INSTRUMENT
+  true;
+#else
+  false;
+#endif
+
+// Totals of every probe, across all threads. The probes are updated without
+// locking, so a snapshot taken while they fire may see a call before the
+// time or bytes it adds.
+Metrics metricsSnapshot();
+void resetMetrics();
+
+} // namespace genpass
+
+#endif // __GENPASS_METRICS_HPP__
@@ -22,11 +22,18 @@
 #define __GENPASS_PASSWORD_HPP__
 
 #include <nlohmann/json_fwd.hpp>  // for json
+#include <atomic>                 // for atomic
 #include <cstddef>                // for size_t
 #include <cstdint>                // for int32_t
+#include <memory>                 // for unique_ptr, shared_ptr
+#include <span>                   // for span
 #include <string>                 // for string, basic_string
-#include <unordered_set>          // for unordered_set
+#include <string_view>            // for string_view
+#include <vector>                 // for vector
 
+#include "genpass/CharClass.hpp"          // for CharClass
+#include "genpass/Policy.hpp"             // for Policy
+#include "genpass/SecureString.hpp"       // for SecureString
 #include "genpass/Seed.hpp"               // for Seed
 
 namespace genpass {
@@ -40,8 +47,22 @@ public:
   virtual ~Password();
 
   virtual std::string generate(const Seed& seed) const = 0;
+  // Like generate(seed), but `mac` is a context from `seed.newMac()` which
+  // may be reused across calls to avoid setting up a new one each time.
+  virtual std::string generate(const Seed& seed, EVP_MAC_CTX *mac) const;
+  // Same, but the password is only ever held in secure memory. By default
+  // it is copied out of generate(), whose string is wiped; the built-in
+  // algorithms generate straight into the SecureString, unless a subclass
+  // has overridden their generate.
+  SecureString generateSecure(const Seed& seed) const;
+  virtual SecureString generateSecure(const Seed& seed,
+    EVP_MAC_CTX *mac) const;
 
   virtual const std::string& algorithmName() const = 0;
+  // A heap-allocated copy of this password, of the same type.
+  virtual std::unique_ptr<Password> clone() const = 0;
+  // The policy the password is laid out by, if its algorithm uses one.
+  virtual const Policy *getPolicy() const { return NULL; }
 
   virtual nlohmann::json serialize() const;
   virtual void deserialize(const nlohmann::json& json);
@@ -58,26 +79,106 @@ class PasswordV2 : public Password {
 public:
   PasswordV2();
   explicit PasswordV2(const std::string& id);
+  PasswordV2(const PasswordV2& other);
   virtual ~PasswordV2();
 
+  PasswordV2& operator=(const PasswordV2& other);
+
   virtual const std::string& algorithmName() const { return algName; }
+  virtual std::unique_ptr<Password> clone() const;
+  virtual const Policy *getPolicy() const { return policy.get(); }
   static void registerWith(Genpass& genpass);
 
   virtual nlohmann::json serialize() const;
   virtual void deserialize(const nlohmann::json& json);
 
   virtual std::string generate(const Seed& seed) const;
+  virtual std::string generate(const Seed& seed, EVP_MAC_CTX *mac) const;
+  using Password::generateSecure;
+  virtual SecureString generateSecure(const Seed& seed,
+    EVP_MAC_CTX *mac) const;
+  // Writes the password to the first `length` chars of `out` without any
+  // heap allocation. Returns the number of chars written, i.e. `length`.
+  std::size_t generateInto(const Seed& seed, std::span<char> out) const;
+  std::size_t generateInto(const Seed& seed, EVP_MAC_CTX *mac,
+    std::span<char> out) const;
+  // The message that is MACed to generate the password: serial || id. It
+  // is built once and kept until `serial` or `id` changes.
+  std::shared_ptr<const std::string> macMessage() const;
+  // Finishes generating the password from the MAC of macMessage().
+  std::string fromMac(const unsigned char *mac, std::size_t macLen) const;
+  std::size_t fromMacInto(const unsigned char *mac, std::size_t macLen,
+    std::span<char> out) const;
   virtual std::string prepare(const std::string& base) const;
+  SecureString prepareSecure(std::string_view base) const;
+  std::size_t prepareInto(std::string_view base, std::span<char> out) const;
 
-  std::size_t length;
-  std::string postfix;
-  std::unordered_set<char> bannedChars;
-  char fill;
+  // Shared with every other password that has the same rules; see
+  // Policy::intern. Never NULL.
+  std::shared_ptr<const Policy> policy;
 
 private:
+  // What generating needs from `serial` and `id`, so that generating the
+  // same password again skips building it.
+  struct Plan {
+    std::int32_t serial;
+    std::string message;
+  };
+  std::shared_ptr<const Plan> getPlan() const;
+
+  // may be replaced by any thread generating the password
+  mutable std::atomic<std::shared_ptr<const Plan>> plan;
+
   static constexpr std::string algName = "genpass-2.0";
 };
 
+// Draws every char of the password uniformly from `alphabet`, from a
+// keystream of any length: HMAC-SHA256 of a 32-bit big-endian counter
+// followed by "genpass-3.0" || serial || id, keyed with the seed. Chars
+// are picked by rejection sampling, so there is no bias and no padding.
+// The chars for each requirement are drawn first, then the rest, and the
+// result is shuffled with the same keystream.
+class PasswordV3 : public Password {
+public:
+  // At least `min` chars of the password are in `chars`.
+  struct Requirement {
+    CharClass chars;
+    std::size_t min;
+
+    friend bool operator==(const Requirement&, const Requirement&) = default;
+  };
+
+  PasswordV3();
+  explicit PasswordV3(const std::string& id);
+  virtual ~PasswordV3();
+
+  virtual const std::string& algorithmName() const { return algName; }
+  virtual std::unique_ptr<Password> clone() const;
+  static void registerWith(Genpass& genpass);
+
+  virtual nlohmann::json serialize() const;
+  virtual void deserialize(const nlohmann::json& json);
+
+  virtual std::string generate(const Seed& seed) const;
+  virtual std::string generate(const Seed& seed, EVP_MAC_CTX *mac) const;
+  using Password::generateSecure;
+  virtual SecureString generateSecure(const Seed& seed,
+    EVP_MAC_CTX *mac) const;
+
+  std::size_t length;
+  CharClass alphabet;
+  std::vector<Requirement> requirements;
+
+private:
+  // Throws std::invalid_argument if no password meets the requirements.
+  void checkRules() const;
+  // Writes the `length` chars of the password to `out`.
+  void generateInto(const Seed& seed, EVP_MAC_CTX *mac,
+    std::span<char> out) const;
+
+  static constexpr std::string algName = "genpass-3.0";
+};
+
 } // namespace genpass
 
 #endif // __GENPASS_PASSWORD_HPP__
@@ -0,0 +1,98 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/Policy.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_POLICY_HPP__
+#define __GENPASS_POLICY_HPP__
+
+#include <nlohmann/json_fwd.hpp>  // for json
+#include <cstddef>                // for size_t
+#include <memory>                 // for shared_ptr
+#include <span>                   // for span
+#include <string>                 // for string
+#include <string_view>            // for string_view
+#include <unordered_set>          // for unordered_set
+
+#include "genpass/CharClass.hpp"  // for CharClass
+
+namespace genpass {
+
+// How a generated password is laid out: which chars are dropped from the
+// generated text, and how the result is padded and finished.
+struct PolicyRules {
+  std::size_t length = 48;
+  std::string postfix = "aA1!";
+  std::unordered_set<char> bannedChars;
+  char fill = '0';
+
+  friend bool operator==(const PolicyRules&, const PolicyRules&) = default;
+};
+
+// An immutable, compiled set of PolicyRules, shared by every password that
+// uses it. Policies are interned: asking twice for the same name and rules
+// gives the same object. A vault writes each policy once and entries refer
+// to it by name.
+class Policy {
+  struct Private { };
+
+public:
+  // Throws std::invalid_argument if the rules are inconsistent, or if the
+  // name starts with '#', which is reserved for unnamed policies in vaults.
+  static std::shared_ptr<const Policy> intern(const std::string& name,
+    const PolicyRules& rules);
+  static std::shared_ptr<const Policy> intern(const PolicyRules& rules) {
+    return intern("", rules);
+  }
+  // The unnamed policy with the default rules.
+  static const std::shared_ptr<const Policy>& defaults();
+
+  Policy(Private, const std::string& name, const PolicyRules& rules);
+  Policy(const Policy&) = delete;
+
+  // Empty if the policy is unnamed.
+  const std::string& getName() const { return name; }
+  const PolicyRules& getRules() const { return rules; }
+  std::size_t getLength() const { return rules.length; }
+
+  // Sets the rules as fields of `json`, a serialized password or an entry
+  // in the policies of a vault.
+  void serialize(nlohmann::json& json) const;
+  static PolicyRules deserializeRules(const nlohmann::json& json);
+
+  // Lays out a password from `base` into the first getLength() chars of
+  // `out`. Returns getLength().
+  std::size_t prepareInto(std::string_view base, std::span<char> out) const;
+  // Same, from the base64 encoding of `mac`.
+  std::size_t fromMacInto(const unsigned char *mac, std::size_t macLen,
+    std::span<char> out) const;
+
+private:
+  // Pads the `n` chars already in `out` and appends the postfix.
+  std::size_t finishLayout(std::size_t n, std::span<char> out) const;
+
+  const std::string name;
+  const PolicyRules rules;
+  // compiled from the rules
+  const CharClass banned;
+  const std::size_t bodyLength;
+};
+
+} // namespace genpass
+
+#endif // __GENPASS_POLICY_HPP__
@@ -0,0 +1,100 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/ReverseIndex.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_REVERSEINDEX_HPP__
+#define __GENPASS_REVERSEINDEX_HPP__
+
+#include <cstddef>      // for size_t
+#include <cstdint>      // for int32_t, uint32_t
+#include <memory>       // for unique_ptr
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+namespace genpass {
+
+class Genpass;
+class SecureString;
+namespace detail { class HmacSha256; }
+
+// Finds which password, at which serial, generated a given password. Built
+// by Genpass::reverseIndex over a window of serials.
+//
+// Only keyed hashes of the generated passwords are kept, under a random key
+// that never leaves the index, and the generated passwords are only held in
+// secure memory until they are hashed. A lookup hashes its input the same
+// way and compares the hashes in constant time.
+class ReverseIndex {
+  friend class Genpass;
+
+public:
+  struct Match {
+    std::string id;
+    std::int32_t serial;
+  };
+
+  ReverseIndex(ReverseIndex&&);
+  ReverseIndex& operator=(ReverseIndex&&);
+  ~ReverseIndex();
+
+  // Every password and serial in the window that generates `password`;
+  // usually none or one.
+  std::vector<Match> find(std::string_view password) const;
+
+  std::int32_t getFirstSerial() const { return firstSerial; }
+  std::int32_t getLastSerial() const { return lastSerial; }
+  // Number of (password, serial) pairs indexed.
+  std::size_t size() const { return count; }
+
+private:
+  static constexpr std::size_t tagLen = 16;
+  static constexpr std::uint32_t noOwner = ~std::uint32_t(0);
+
+  struct Slot {
+    unsigned char tag[tagLen];
+    std::uint32_t owner;
+    std::int32_t serial;
+  };
+
+  ReverseIndex(std::vector<std::string>&& ids, std::int32_t firstSerial,
+    std::int32_t lastSerial);
+
+  // Hashes `password` into `tag`.
+  void tagOf(std::string_view password, unsigned char *tag) const;
+  // Hashes `generated[i]`, which the password `ids[i]` generated at
+  // `serial`, on up to `threads` threads.
+  void add(const std::vector<SecureString>& generated, std::int32_t serial,
+    unsigned threads);
+  void insert(const unsigned char *tag, std::uint32_t owner,
+    std::int32_t serial);
+  std::size_t mask() const { return slots.size() - 1; }
+  static std::size_t slotOf(const unsigned char *tag);
+
+  std::unique_ptr<detail::HmacSha256> hmac;
+  std::vector<std::string> ids;
+  std::int32_t firstSerial, lastSerial;
+  // open addressing with linear probing, at most half full
+  std::vector<Slot> slots;
+  std::size_t count;
+};
+
+} // namespace genpass
+
+#endif // __GENPASS_REVERSEINDEX_HPP__
@@ -0,0 +1,68 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/SecureString.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_SECURESTRING_HPP__
+#define __GENPASS_SECURESTRING_HPP__
+
+#include <cstddef>      // for size_t, NULL
+#include <span>         // for span
+#include <string_view>  // for string_view
+
+namespace genpass {
+
+// A string for secrets, such as generated passwords. The chars are kept in
+// memory that is locked into RAM where the system allows it and zeroed when
+// the string is destroyed or assigned, and that is only ever reused for
+// other secrets. The length is fixed when the string is made; the chars are
+// always followed by a NUL.
+class SecureString {
+public:
+  SecureString() = default;
+  // `size` NUL chars, to be written through data().
+  explicit SecureString(std::size_t size);
+  explicit SecureString(std::string_view str);
+  SecureString(const SecureString& other);
+  SecureString(SecureString&& other) noexcept;
+  ~SecureString();
+
+  SecureString& operator=(const SecureString& other);
+  SecureString& operator=(SecureString&& other) noexcept;
+
+  char *data() { return buf; }
+  const char *data() const { return buf ? buf : ""; }
+  const char *c_str() const { return data(); }
+  std::size_t size() const { return len; }
+  bool empty() const { return !len; }
+
+  std::span<char> span() { return std::span<char>(buf, len); }
+  std::string_view view() const { return std::string_view(data(), len); }
+  operator std::string_view() const { return view(); }
+
+  // Takes the same time for any two strings of the same length.
+  friend bool operator==(const SecureString& a, const SecureString& b);
+
+private:
+  char *buf = NULL;
+  std::size_t len = 0;
+};
+
+} // namespace genpass
+
+#endif // __GENPASS_SECURESTRING_HPP__
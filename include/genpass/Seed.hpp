@@ -21,36 +21,148 @@
 #ifndef __GENPASS_SEED_HPP__
 #define __GENPASS_SEED_HPP__
 
-#include <filesystem>  // for path
-#include <memory>      // for unique_ptr
-#include <string>      // for string
-#include <utility>     // for move
+#include <chrono>       // for milliseconds
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint32_t
+#include <filesystem>   // for path
+#include <memory>       // for unique_ptr, shared_ptr
+#include <string>       // for string
+#include <string_view>  // for string_view
 
 class evp_skey_st;
+class evp_mac_ctx_st;
 
 using EVP_SKEY = evp_skey_st;
+using EVP_MAC_CTX = evp_mac_ctx_st;
 
 namespace genpass {
 
+namespace detail { class HmacSha256; }
+
+// The key derivation functions a seed file may be encrypted under. scrypt
+// and Argon2id are memory-hard; Argon2id needs OpenSSL 3.2 or later.
+enum class SeedKdf : std::uint32_t {
+  pbkdf2 = 1,
+  scrypt = 2,
+  argon2id = 3,
+};
+
+// The cost of deriving a seed file's key from its password. The fields mean
+// different things for each KDF:
+//   pbkdf2    PBKDF2-HMAC-SHA256 with `iterations` rounds. The other fields
+//             are unused and must be 0 and 1.
+//   scrypt    N = `memoryKiB`, a power of two, with r = 8, so that N is
+//             also the memory used in KiB, and p = `parallelism`.
+//             `iterations` is unused and must be 0.
+//   argon2id  `iterations` passes over `memoryKiB` KiB in `parallelism`
+//             lanes.
+// The defaults are the second recommendation of RFC 9106, the one for
+// memory-constrained environments.
+struct SeedKdfParams {
+  SeedKdf kdf = SeedKdf::argon2id;
+  std::uint32_t iterations = 3;
+  std::uint32_t memoryKiB = 1 << 16;
+  std::uint32_t parallelism = 4;
+
+  // Throws std::invalid_argument if the parameters are out of range for
+  // the KDF.
+  void check() const;
+};
+
 class Seed {
   using EVP_SKEY_ptr = std::unique_ptr<EVP_SKEY, void (*)(EVP_SKEY *)>;
 
 public:
-  Seed(EVP_SKEY_ptr&& key)
-    : key(std::move(key))
-  { }
-  ~Seed() { }
+  using EVP_MAC_CTX_ptr = std::unique_ptr<EVP_MAC_CTX, void (*)(EVP_MAC_CTX *)>;
+
+  Seed(EVP_SKEY_ptr&& key);
+  ~Seed();
 
   EVP_SKEY *getKey() const { return key.get(); }
 
+  // Returns a new HMAC-SHA256 context that is already keyed with this seed.
+  // This is only a copy of a pre-keyed template, so it avoids the algorithm
+  // fetch and key schedule. The context may be reused for any number of
+  // MACs by resetting it with `EVP_MAC_init(ctx, NULL, 0, NULL)`.
+  EVP_MAC_CTX_ptr newMac() const;
+
+  // Returns the built-in multi-buffer HMAC-SHA256 keyed with this seed, or
+  // NULL if it is not available. It is only available if enabled at build
+  // time and if it gives the same results as OpenSSL for this key.
+  const detail::HmacSha256 *getHmacEngine() const { return hmacEngine.get(); }
+
+  // The child seed for `label`, derived from this one with HKDF-SHA256, so
+  // that one unlocked seed can serve any number of separate namespaces.
+  // Children are unrelated to each other and to their parent without the
+  // parent; they may derive children of their own. The most recently used
+  // children are cached, with their MAC contexts, so that deriving one
+  // again is only a lookup. Thread-safe.
+  //
+  // Cached children are not held in locked memory. Only the built-in HMAC
+  // engine's key schedule is. Each child's EVP_SKEY and pre-keyed MAC
+  // template are allocated by OpenSSL, on the general heap unless
+  // initSecureHeap was called, and even then only partly in locked memory.
+  std::shared_ptr<const Seed> derive(std::string_view label) const;
+  // Number of children kept by the cache; 64 by default. Zero disables it.
+  void setDeriveCacheSize(std::size_t size) const;
+
+  // Opt-in: starts OpenSSL's secure heap of `bytes` (a power of two) in
+  // locked memory, so that OpenSSL keeps the copies of keys it makes for MAC
+  // contexts there, those of cached children included. The hashed key state
+  // in those contexts and the EVP_SKEYs stay on the general heap. Must be
+  // called before any seed is loaded; does nothing if the secure heap is
+  // already running. Returns false if it could not be started.
+  static bool initSecureHeap(std::size_t bytes = 1 << 20);
+
+  // A new seed from the system's random number generator.
+  static Seed random();
+
+  // Reads a seed file, either one written by writeEncryptedFile, or an
+  // OpenSSL `enc -aes-256-ecb -pbkdf2` file (starting with "Salted__") as
+  // written by earlier versions.
   static Seed fromEncryptedFile(
     const std::filesystem::path& file,
     const std::string& password
   );
+  // Same, for a seed to be shared, e.g. by asynchronous requests. Seeds
+  // cannot be moved, so this is the way to get a loaded one onto the heap.
+  // The password may be held anywhere, such as in a SecureString.
+  static std::shared_ptr<const Seed> sharedFromEncryptedFile(
+    const std::filesystem::path& file,
+    std::string_view password
+  );
+  // Writes this seed to `file`, encrypted with AES-256-GCM under a key
+  // derived from `password` by the KDF in `params`. The KDF and its
+  // parameters are recorded in the file's header, so the file can be read
+  // back without them. The old file is replaced atomically.
+  void writeEncryptedFile(
+    const std::filesystem::path& file,
+    const std::string& password,
+    const SeedKdfParams& params = SeedKdfParams()
+  ) const;
+  // The parameters recorded in the seed file `file`, without decrypting
+  // it. For a "Salted__" file, they are the iterations of that fixed
+  // format, whose PBKDF2 uses SHA-1 rather than SHA-256.
+  static SeedKdfParams readKdfParams(const std::filesystem::path& file);
+
+  // Times `kdf` on this machine and returns the parameters that make one
+  // derivation take about `target`. For the memory-hard KDFs, `memoryKiB`
+  // is halved until one pass over it takes no longer than `target`, and the
+  // rest of the time goes to more passes (Argon2id) or a larger p (scrypt).
+  // Takes a few times `target` to run.
+  static SeedKdfParams calibrateKdf(
+    SeedKdf kdf,
+    std::chrono::milliseconds target,
+    std::uint32_t memoryKiB = 1 << 16
+  );
 
 private:
+  class ChildCache;
 
   const EVP_SKEY_ptr key;
+  const EVP_MAC_CTX_ptr macTemplate;
+  const std::unique_ptr<const detail::HmacSha256> hmacEngine;
+  const std::unique_ptr<ChildCache> children;
 };
 
 } // namespace genpass
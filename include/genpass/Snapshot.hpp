@@ -0,0 +1,85 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/Snapshot.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_SNAPSHOT_HPP__
+#define __GENPASS_SNAPSHOT_HPP__
+
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint64_t
+#include <memory>       // for shared_ptr
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <utility>      // for pair
+#include <vector>       // for vector
+
+#include "genpass/Password.hpp"           // for Password
+#include "genpass/SecureString.hpp"       // for SecureString
+#include "genpass/Seed.hpp"               // for Seed
+#include "genpass/detail/IndirectIterator.hpp"
+
+namespace genpass {
+
+// An immutable copy of the passwords of a Genpass, as of one call to
+// Genpass::publish. Since it never changes, any number of threads may use
+// it at once. Passwords that did not change between two versions are
+// shared by them.
+class Snapshot {
+public:
+  using Entries = std::vector<std::shared_ptr<const Password>>;
+  using ConstPasswordIterator = detail::IndirectIterator<
+    const Password, Entries::const_iterator,
+    [](const auto& it) -> const Password * { return it->get(); }
+  >;
+
+  Snapshot(Entries&& entries, std::uint64_t version, unsigned threadCount);
+
+  // Counts the calls to Genpass::publish, starting from one.
+  std::uint64_t getVersion() const { return version; }
+  std::size_t size() const { return entries.size(); }
+
+  // Throws std::out_of_range if there is no password with `id`.
+  const Password& getPassword(std::string_view id) const;
+  // Returns NULL if there is no password with `id`.
+  const Password *findPassword(std::string_view id) const;
+
+  // Ordered by ID.
+  ConstPasswordIterator passwords_cbegin() const { return entries.cbegin(); }
+  ConstPasswordIterator passwords_cend() const { return entries.cend(); }
+
+  // Same as Genpass::generate, Genpass::generateSecure and
+  // Genpass::generateAll, with the thread count the Genpass had when this
+  // was published.
+  std::vector<std::string> generate(const Seed& seed,
+    const std::vector<std::string>& ids) const;
+  std::vector<SecureString> generateSecure(const Seed& seed,
+    const std::vector<std::string>& ids) const;
+  std::vector<std::pair<std::string, std::string>>
+  generateAll(const Seed& seed) const;
+
+private:
+  // sorted by ID
+  const Entries entries;
+  const std::uint64_t version;
+  const unsigned threadCount;
+};
+
+} // namespace genpass
+
+#endif // __GENPASS_SNAPSHOT_HPP__
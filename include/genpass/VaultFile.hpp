@@ -0,0 +1,100 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/VaultFile.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_VAULTFILE_HPP__
+#define __GENPASS_VAULTFILE_HPP__
+
+#include <nlohmann/json_fwd.hpp>  // for json
+#include <cstddef>                // for size_t
+#include <cstdint>                // for uint32_t, uint64_t
+#include <filesystem>             // for path
+#include <functional>             // for function
+#include <string>                 // for string
+#include <string_view>            // for string_view
+#include <vector>                 // for vector
+
+#include "genpass/Genpass.hpp"            // for Genpass
+#include "genpass/Password.hpp"           // for Password
+
+namespace genpass {
+
+// A read-only binary vault that is memory-mapped rather than parsed. Its
+// header holds an index of the IDs sorted bytewise, so a lookup is a binary
+// search over the mapping, and a Password is only constructed the first
+// time its ID is asked for.
+//
+// All integers are little-endian. The layout is
+//   header:  "GPVAULT\0", u32 version (1), u32 entry count
+//   index:   per entry, sorted by ID:
+//            u64 ID offset, u64 record offset, u32 ID length,
+//            u32 record length
+//   data:    the IDs, followed by the records
+// where each record is the MessagePack encoding of Password::serialize()
+// and offsets are from the start of the file.
+class VaultFile {
+public:
+  explicit VaultFile(const std::filesystem::path& file);
+  VaultFile(const VaultFile&) = delete;
+  ~VaultFile();
+
+  std::size_t size() const { return count; }
+  // The ID of the i-th entry, in ascending order.
+  std::string_view idAt(std::size_t i) const;
+  bool contains(std::string_view id) const;
+  // The serialized form of the password with `id`.
+  nlohmann::json getRecord(std::string_view id) const;
+
+  // Returns the password with `id`, constructing it on first access.
+  // Throws std::out_of_range if there is none.
+  Password& getPassword(std::string_view id);
+
+  // The registry used to construct passwords. It also holds every password
+  // constructed so far, e.g. for Genpass::generate.
+  const Genpass& getGenpass() const { return genpass; }
+  void registerAlgorithm(const std::string& name,
+    std::function<Password *()> constructor);
+
+  // Writes the passwords in `genpass` as a binary vault, atomically
+  // replacing `file`.
+  static void write(const Genpass& genpass, const std::filesystem::path& file);
+  // Converts between the binary format and the JSON layout of
+  // Genpass::serialize. fromJson also reads the other VaultFormats.
+  static void fromJson(const std::filesystem::path& json,
+    const std::filesystem::path& vault);
+  static void toJson(const std::filesystem::path& vault,
+    const std::filesystem::path& json);
+
+private:
+  // Returns the index of `id`, or size() if there is none.
+  std::size_t find(std::string_view id) const;
+  const unsigned char *indexEntry(std::size_t i) const;
+  std::string_view slice(std::uint64_t offset, std::uint32_t len) const;
+  nlohmann::json recordAt(std::size_t i) const;
+
+  const unsigned char *map;
+  std::size_t mapLen;
+  std::size_t count;
+  Genpass genpass;
+  std::vector<Password *> loaded;
+};
+
+} // namespace genpass
+
+#endif // __GENPASS_VAULTFILE_HPP__
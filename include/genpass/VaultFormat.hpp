@@ -0,0 +1,76 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/VaultFormat.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_VAULTFORMAT_HPP__
+#define __GENPASS_VAULTFORMAT_HPP__
+
+#include <nlohmann/json.hpp>  // for basic_json
+#include <cstdint>            // for uintmax_t
+#include <filesystem>         // for path
+#include <iosfwd>             // for ostream
+#include <string_view>        // for string_view
+
+namespace genpass {
+
+// The encodings a vault document can be stored in. Every encoding holds the
+// same document as Genpass::serialize; the binary ones are smaller and
+// faster to parse.
+enum class VaultFormat { json, cbor, msgpack, ubjson, bson };
+
+// "json", "cbor", "msgpack", "ubjson" or "bson".
+const char *vaultFormatName(VaultFormat format);
+// Throws std::invalid_argument if `name` is not one of the above.
+VaultFormat vaultFormatFromName(std::string_view name);
+
+// Tells the encoding of a vault from its first bytes (at least five) and its
+// total size in bytes. Anything unrecognized is taken to be JSON.
+VaultFormat detectVaultFormat(std::string_view head, std::uintmax_t size);
+VaultFormat detectVaultFormat(const std::filesystem::path& file);
+
+// Re-encodes the vault `in`, in whatever format it is, as `format`, and
+// atomically replaces `out` with it. Entries are copied as they are, so
+// passwords of algorithms that are not registered survive.
+void convertVault(const std::filesystem::path& in,
+  const std::filesystem::path& out, VaultFormat format);
+
+namespace detail {
+
+inline nlohmann::json::input_format_t
+inputFormat(VaultFormat format) {
+  switch(format) {
+    case VaultFormat::cbor: return nlohmann::json::input_format_t::cbor;
+    case VaultFormat::msgpack: return nlohmann::json::input_format_t::msgpack;
+    case VaultFormat::ubjson: return nlohmann::json::input_format_t::ubjson;
+    case VaultFormat::bson: return nlohmann::json::input_format_t::bson;
+    default: return nlohmann::json::input_format_t::json;
+  }
+}
+
+// Writes a whole vault document in `format`. The keys are written in the
+// order of `vault`, which should have "policies" before "passwords", so that
+// a streaming load has the policy table before any entry refers to it.
+void writeVault(const nlohmann::ordered_json& vault, std::ostream& out,
+  VaultFormat format);
+
+} // namespace detail
+
+} // namespace genpass
+
+#endif // __GENPASS_VAULTFORMAT_HPP__
@@ -0,0 +1,65 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/detail/HmacSha256.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_UTIL_HMACSHA256_HPP__
+#define __GENPASS_UTIL_HMACSHA256_HPP__
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint32_t
+
+namespace genpass::detail {
+
+// A built-in HMAC-SHA256 for many short messages under one key. Up to
+// `lanes` messages are hashed side by side; with AVX2 each lane is one
+// 32-bit element of a vector register. The kernel is picked at runtime and
+// falls back to plain scalar code.
+class HmacSha256 {
+public:
+  static constexpr std::size_t macSize = 32;
+  static constexpr std::size_t lanes = 8;
+
+  HmacSha256(const unsigned char *key, std::size_t keyLen);
+  HmacSha256(const HmacSha256&) = delete;
+  ~HmacSha256();
+
+  // The state is as good as the key, so it is kept in secure memory.
+  static void *operator new(std::size_t size);
+  static void operator delete(void *p, std::size_t size) noexcept;
+
+  void mac(const unsigned char *msg, std::size_t len,
+    unsigned char *out) const;
+  // Computes `count` (at most `lanes`) MACs at once.
+  void macMulti(std::size_t count, const unsigned char *const *msgs,
+    const std::size_t *lens, unsigned char *const *outs) const;
+
+  // Name of the kernel in use, e.g. "avx2" or "scalar".
+  static const char *kernelName();
+  // Checks the kernels against the RFC 4231 test vectors. The test runs on
+  // the first call; later calls return its result.
+  static bool selfTest();
+
+private:
+  std::uint32_t inner[8];
+  std::uint32_t outer[8];
+};
+
+} // namespace genpass::detail
+
+#endif // __GENPASS_UTIL_HMACSHA256_HPP__
@@ -0,0 +1,85 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/detail/IdIndex.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_UTIL_IDINDEX_HPP__
+#define __GENPASS_UTIL_IDINDEX_HPP__
+
+#include <cstddef>        // for size_t
+#include <cstdint>        // for uint32_t
+#include <memory>         // for unique_ptr
+#include <string>         // for string
+#include <string_view>    // for string_view
+#include <unordered_map>  // for unordered_map
+#include <vector>         // for vector
+
+#include "genpass/detail/PasswordRange.hpp"  // for PasswordRange
+
+namespace genpass {
+
+class Password;
+
+namespace detail {
+
+// A search index over password IDs. It keeps its own copy of each ID, so
+// that it stays ordered while `id` fields are edited, until update() or
+// insert/erase are called for them.
+//
+// IDs are kept sorted for prefix and edit distance queries, and every
+// distinct trigram of an ID has a posting list for substring queries.
+class IdIndex {
+public:
+  IdIndex() = default;
+  IdIndex(const IdIndex&) = delete;
+  ~IdIndex();
+
+  // Indexes passwords under their current IDs, in bulk.
+  void build(const std::vector<Password *>& passwords);
+  void insert(Password *password);
+  // Removes `password`, which was indexed under `id`.
+  void erase(std::string_view id, const Password *password);
+  // Re-indexes every password whose ID has changed since it was indexed.
+  void update();
+  void clear();
+
+  // The results are ordered by ID, except for substring().
+  PasswordRange prefix(std::string_view prefix) const;
+  PasswordRange substring(std::string_view needle) const;
+  PasswordRange fuzzy(std::string_view id, unsigned maxEdits) const;
+
+private:
+  struct Entry {
+    std::string id;
+    Password *password;
+  };
+
+  void addGrams(Entry *entry);
+  void removeGrams(Entry *entry);
+  // The first entry whose ID is not less than `id`.
+  std::size_t lowerBound(std::string_view id) const;
+
+  // sorted by ID
+  std::vector<std::unique_ptr<Entry>> sorted;
+  std::unordered_map<std::uint32_t, std::vector<Entry *>> grams;
+};
+
+} // namespace detail
+} // namespace genpass
+
+#endif // __GENPASS_UTIL_IDINDEX_HPP__
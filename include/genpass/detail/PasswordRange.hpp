@@ -0,0 +1,85 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/detail/PasswordRange.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_UTIL_PASSWORDRANGE_HPP__
+#define __GENPASS_UTIL_PASSWORDRANGE_HPP__
+
+#include <cstddef>     // for ptrdiff_t, NULL
+#include <functional>  // for function
+#include <iterator>    // for default_sentinel_t, input_iterator_tag
+#include <utility>     // for move
+
+namespace genpass {
+
+class Password;
+
+namespace detail {
+
+// A single-pass range of passwords that are produced one at a time by
+// `next`, which returns NULL when there are no more. Nothing is computed
+// until the range is iterated.
+class PasswordRange {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Password;
+    using difference_type = std::ptrdiff_t;
+    using reference = Password&;
+
+    iterator() = default;
+    explicit iterator(PasswordRange *range) : range(range) { }
+    Password& operator*() const { return *range->current; }
+    Password *operator->() const { return range->current; }
+    iterator& operator++() { range->advance(); return *this; }
+    void operator++(int) { range->advance(); }
+    friend bool operator==(const iterator& it, std::default_sentinel_t) {
+      return !*it.range;
+    }
+  private:
+    PasswordRange *range = NULL;
+  };
+
+  explicit PasswordRange(std::function<Password *()> next)
+    : next(std::move(next)) { }
+
+  iterator begin() {
+    if(!started) advance();
+    return iterator(this);
+  }
+  std::default_sentinel_t end() const { return {}; }
+  // False once the range is exhausted.
+  explicit operator bool() const { return current; }
+
+private:
+  void advance() {
+    started = true;
+    current = next();
+  }
+
+  std::function<Password *()> next;
+  Password *current = NULL;
+  bool started = false;
+};
+
+} // namespace detail
+} // namespace genpass
+
+#endif // __GENPASS_UTIL_PASSWORDRANGE_HPP__
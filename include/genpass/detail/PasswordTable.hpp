@@ -0,0 +1,108 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/detail/PasswordTable.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_UTIL_PASSWORDTABLE_HPP__
+#define __GENPASS_UTIL_PASSWORDTABLE_HPP__
+
+#include <cstddef>      // for size_t, ptrdiff_t
+#include <iterator>     // for input_iterator_tag
+#include <string_view>  // for string_view
+#include <utility>      // for pair
+#include <vector>       // for vector
+
+namespace genpass {
+
+class Password;
+
+namespace detail {
+
+// An open-addressing hash set of passwords, keyed by their own `id` fields.
+// Each slot is just the hash and the pointer, so the IDs are not copied
+// and a lookup usually touches one slot and one password.
+//
+// Since the key lives in the password, an entry goes stale when its `id` is
+// changed; it stays under the hash of its old ID until it is erased and
+// reinserted.
+class PasswordTable {
+private:
+  struct Slot {
+    std::size_t hash;
+    Password *password;  // NULL if the slot is empty
+  };
+
+public:
+  class iterator {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Password *;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Password *const *;
+    using reference = Password *;
+
+    iterator() = default;
+    iterator(const Slot *slot, const Slot *end) : slot(slot), end(end) {
+      skipEmpty();
+    }
+    friend bool operator==(const iterator&, const iterator&) = default;
+    iterator& operator++() { ++slot; skipEmpty(); return *this; }
+    iterator operator++(int) { iterator ret = *this; ++*this; return ret; }
+    Password *operator*() const { return slot->password; }
+  private:
+    void skipEmpty() { while(slot != end && !slot->password) ++slot; }
+    const Slot *slot = NULL;
+    const Slot *end = NULL;
+  };
+
+  static std::size_t hashId(std::string_view id);
+
+  std::size_t size() const { return count; }
+  bool empty() const { return !count; }
+  iterator begin() const { return {slots.data(), slots.data() + slots.size()}; }
+  iterator end() const {
+    return {slots.data() + slots.size(), slots.data() + slots.size()};
+  }
+
+  Password *find(std::string_view id) const;
+  // Like find, but if no password has `id`, finds one that went stale
+  // after being inserted with that ID.
+  Password *findStale(std::string_view oldId) const;
+
+  // Inserts `password` under `hash`, normally hashId(password->id). Returns
+  // false if there already is a password with the same ID.
+  bool insert(Password *password, std::size_t hash);
+  bool insert(Password *password);
+  // Removes `password`, which was inserted under `hash`.
+  void erase(const Password *password, std::size_t hash);
+  // Removes every stale password, returning each with its old hash.
+  std::vector<std::pair<Password *, std::size_t>> extractStale();
+  void clear();
+  void reserve(std::size_t n);
+
+private:
+  std::size_t mask() const { return slots.size() - 1; }
+
+  std::vector<Slot> slots;
+  std::size_t count = 0;
+};
+
+} // namespace detail
+} // namespace genpass
+
+#endif // __GENPASS_UTIL_PASSWORDTABLE_HPP__
@@ -0,0 +1,113 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/detail/VaultLoader.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_UTIL_VAULTLOADER_HPP__
+#define __GENPASS_UTIL_VAULTLOADER_HPP__
+
+#include <nlohmann/json.hpp>  // for basic_json
+#include <cstddef>            // for size_t
+#include <string>             // for string
+#include <vector>             // for vector
+
+#include "genpass/detail/instrument.hpp"  // for Stopwatch
+
+namespace genpass {
+
+class Genpass;
+
+namespace detail {
+
+// Builds a single JSON value from SAX events.
+class JsonBuilder {
+public:
+  // Adds a scalar. Returns true if it completes the value.
+  bool value(nlohmann::json&& v);
+  void startContainer(nlohmann::json&& empty);
+  // Returns true if this closes the outermost container.
+  bool endContainer();
+  void key(std::string&& k);
+  nlohmann::json take();
+
+private:
+  nlohmann::json *put(nlohmann::json&& v);
+
+  nlohmann::json root;
+  std::vector<nlohmann::json *> stack;
+  std::string pendingKey;
+};
+
+// A SAX handler that loads a vault straight into a Genpass. Entries of the
+// "passwords" array are held as JSON only until a batch of them is
+// complete; each batch is then turned into Passwords, on several threads,
+// and dropped. If the "policies" the entries refer to come after
+// "passwords" rather than before, as Genpass::serializeTo writes them,
+// those entries are held until the end.
+class VaultLoader {
+public:
+  using json = nlohmann::json;
+
+  explicit VaultLoader(Genpass& genpass);
+
+  // Reports problems found while loading. Call after parsing.
+  void finish();
+
+  bool null();
+  bool boolean(bool val);
+  bool number_integer(json::number_integer_t val);
+  bool number_unsigned(json::number_unsigned_t val);
+  bool number_float(json::number_float_t val, const json::string_t& s);
+  bool string(json::string_t& val);
+  bool binary(json::binary_t& val);
+  bool start_object(std::size_t elements);
+  bool key(json::string_t& val);
+  bool end_object();
+  bool start_array(std::size_t elements);
+  bool end_array();
+
+  template<typename Exception>
+  bool parse_error(std::size_t, const std::string&, const Exception& ex) {
+    throw ex;
+  }
+
+private:
+  bool value(json&& v);
+  void load(json&& entry);
+  void flush();
+  bool startContainer(json&& empty);
+  bool endContainer();
+
+  Genpass& genpass;
+  std::size_t depth;
+  std::string topKey;
+  bool inPasswords;
+  bool sawPasswords;
+  bool unknownAlg;
+  JsonBuilder builder;
+  json policies;
+  json::array_t batch;
+  json::array_t deferred;
+  [[no_unique_address]] Stopwatch parseTime;
+};
+
+} // namespace detail
+
+} // namespace genpass
+
+#endif // __GENPASS_UTIL_VAULTLOADER_HPP__
@@ -0,0 +1,59 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/detail/VaultPolicies.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_UTIL_VAULTPOLICIES_HPP__
+#define __GENPASS_UTIL_VAULTPOLICIES_HPP__
+
+#include <nlohmann/json.hpp>  // for basic_json
+#include <cstddef>            // for size_t
+#include <string>             // for string
+#include <unordered_map>      // for unordered_map
+
+#include "genpass/Password.hpp"  // for Password
+#include "genpass/Policy.hpp"    // for Policy
+
+namespace genpass::detail {
+
+// The "policies" object of a vault. Each policy used by its passwords is
+// written there once, under its name or, if it has none, under a name
+// starting with '#'; the entries then refer to it instead of repeating its
+// fields.
+class VaultPolicies {
+public:
+  // Adds the policy of `password`, if any.
+  void add(const Password& password);
+  const nlohmann::json& table() const { return policies; }
+
+  // Replaces the fields of the serialized `entry` that its policy covers
+  // with a reference to the policy.
+  void compact(const Password& password, nlohmann::json& entry) const;
+
+  // Restores the fields of an entry from the `policies` of a vault, and
+  // drops references to unnamed policies.
+  static void expand(nlohmann::json& entry, const nlohmann::json& policies);
+
+private:
+  nlohmann::json policies = nlohmann::json::object();
+  std::unordered_map<const Policy *, std::string> keys;
+};
+
+} // namespace genpass::detail
+
+#endif // __GENPASS_UTIL_VAULTPOLICIES_HPP__
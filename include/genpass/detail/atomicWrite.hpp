@@ -0,0 +1,39 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/detail/atomicWrite.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_UTIL_ATOMICWRITE_HPP__
+#define __GENPASS_UTIL_ATOMICWRITE_HPP__
+
+#include <filesystem>  // for path
+#include <functional>  // for function
+#include <ostream>     // for ostream
+
+namespace genpass::detail {
+
+// Replaces `file` with what `write` writes, such that a crash at any point
+// leaves either the old or the new contents. The data goes to a temporary
+// file in the same directory, which is synced and then renamed over `file`.
+// An existing file's permissions are kept.
+void atomicWrite(const std::filesystem::path& file,
+  const std::function<void(std::ostream&)>& write);
+
+} // namespace genpass::detail
+
+#endif // __GENPASS_UTIL_ATOMICWRITE_HPP__
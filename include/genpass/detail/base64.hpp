@@ -0,0 +1,38 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/detail/base64.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_UTIL_BASE64_HPP__
+#define __GENPASS_UTIL_BASE64_HPP__
+
+#include <cstddef>  // for size_t
+
+#include "genpass/CharClass.hpp"  // for CharClass
+
+namespace genpass::detail {
+
+// Base64-encodes `in` exactly like EVP_EncodeBlock (with '=' padding and no
+// line breaks), dropping any character in `banned` on the fly. At most
+// `cap` characters are written to `out`; the number written is returned.
+std::size_t base64Filtered(const unsigned char *in, std::size_t len,
+  const CharClass& banned, char *out, std::size_t cap);
+
+} // namespace genpass::detail
+
+#endif // __GENPASS_UTIL_BASE64_HPP__
@@ -0,0 +1,47 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/detail/generateBatch.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_UTIL_GENERATEBATCH_HPP__
+#define __GENPASS_UTIL_GENERATEBATCH_HPP__
+
+#include <string>  // for string
+#include <vector>  // for vector
+
+#include "genpass/Password.hpp"      // for Password
+#include "genpass/SecureString.hpp"  // for SecureString
+#include "genpass/Seed.hpp"          // for Seed
+
+namespace genpass::detail {
+
+// Generates `batch` on up to `threads` threads (zero meaning one per
+// hardware thread). Plain PasswordV2 entries go through the seed's
+// multi-buffer HMAC engine when it has one. The results are in the same
+// order as `batch`.
+std::vector<std::string> generateBatch(const Seed& seed,
+  const std::vector<const Password *>& batch, unsigned threads);
+// Same, with each password only ever held in secure memory. Beyond the
+// results, plain PasswordV2 entries on the multi-buffer HMAC allocate
+// nothing once their MAC message is built.
+std::vector<SecureString> generateBatchSecure(const Seed& seed,
+  const std::vector<const Password *>& batch, unsigned threads);
+
+} // namespace genpass::detail
+
+#endif // __GENPASS_UTIL_GENERATEBATCH_HPP__
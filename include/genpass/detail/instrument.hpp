@@ -0,0 +1,113 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/detail/instrument.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_UTIL_INSTRUMENT_HPP__
+#define __GENPASS_UTIL_INSTRUMENT_HPP__
+
+// The probes behind genpass/Metrics.hpp. Without GENPASS_INSTRUMENT, every
+// macro expands to nothing, without evaluating its arguments, and Stopwatch
+// is empty.
+
+#ifdef GENPASS_INSTRUMENT
+#include <atomic>   // for atomic, memory_order_relaxed
+#include <chrono>   // for steady_clock, nanoseconds, duration_cast
+#include <cstdint>  // for uint64_t
+#endif
+
+namespace genpass::detail {
+
+#ifdef GENPASS_INSTRUMENT
+
+// One call site's totals. Probes are static, and link themselves into a
+// global list the first time they are reached; several may share a name.
+class Probe {
+public:
+  explicit Probe(const char *name);
+  Probe(const Probe&) = delete;
+
+  void record(std::uint64_t nanoseconds, std::uint64_t bytes) {
+    calls.fetch_add(1, std::memory_order_relaxed);
+    if(nanoseconds) this->nanoseconds.fetch_add(nanoseconds,
+      std::memory_order_relaxed);
+    if(bytes) this->bytes.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  const char *const name;
+  std::atomic<std::uint64_t> calls, nanoseconds, bytes;
+  Probe *next;
+};
+
+class Stopwatch {
+public:
+  Stopwatch() : start(std::chrono::steady_clock::now()) { }
+
+  std::uint64_t elapsed() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  }
+
+private:
+  std::chrono::steady_clock::time_point start;
+};
+
+// Records one call to `probe`, timed until the end of the scope.
+class ProbeTimer {
+public:
+  ProbeTimer(Probe& probe, std::uint64_t bytes)
+    : probe(probe), bytes(bytes) { }
+  ProbeTimer(const ProbeTimer&) = delete;
+  ~ProbeTimer() { probe.record(watch.elapsed(), bytes); }
+
+private:
+  Probe& probe;
+  const std::uint64_t bytes;
+  const Stopwatch watch;
+};
+
+#define GENPASS_PROBE_CAT2_(a, b) a##b
+#define GENPASS_PROBE_CAT_(a, b) GENPASS_PROBE_CAT2_(a, b)
+
+// Times the rest of the enclosing scope, as one call handling `bytes`.
+#define GENPASS_TIME(name, bytes) \
+  static ::genpass::detail::Probe \
+    GENPASS_PROBE_CAT_(genpassProbe, __LINE__)(name); \
+  const ::genpass::detail::ProbeTimer \
+    GENPASS_PROBE_CAT_(genpassTimer, __LINE__)( \
+      GENPASS_PROBE_CAT_(genpassProbe, __LINE__), (bytes))
+// Records one call handling `bytes`, taking `nanoseconds`.
+#define GENPASS_RECORD(name, nanoseconds, bytes) do { \
+    static ::genpass::detail::Probe genpassProbe(name); \
+    genpassProbe.record((nanoseconds), (bytes)); \
+  } while(0)
+#define GENPASS_COUNT(name, bytes) GENPASS_RECORD(name, 0, bytes)
+
+#else // GENPASS_INSTRUMENT
+
+class Stopwatch { };
+
+#define GENPASS_TIME(name, bytes) static_assert(true)
+#define GENPASS_RECORD(name, nanoseconds, bytes) ((void)0)
+#define GENPASS_COUNT(name, bytes) ((void)0)
+
+#endif // GENPASS_INSTRUMENT
+
+} // namespace genpass::detail
+
+#endif // __GENPASS_UTIL_INSTRUMENT_HPP__
@@ -0,0 +1,80 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/detail/parallel.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_UTIL_PARALLEL_HPP__
+#define __GENPASS_UTIL_PARALLEL_HPP__
+
+#include <algorithm>  // for min
+#include <cstddef>    // for size_t
+#include <exception>  // for exception_ptr, current_exception, rethrow_...
+#include <mutex>      // for mutex, lock_guard
+#include <thread>     // for jthread, thread
+#include <vector>     // for vector
+
+namespace genpass::detail {
+
+// Returns the number of workers to use for `count` items when `threads`
+// workers were requested. Zero requests one per hardware thread.
+inline unsigned
+workerCount(std::size_t count, unsigned threads) {
+  if(!threads) threads = std::max(std::thread::hardware_concurrency(), 1u);
+  return (unsigned)std::min<std::size_t>(threads, std::max<std::size_t>(count, 1));
+}
+
+// Splits [0, count) into one contiguous chunk per worker and calls
+// `fn(begin, end, worker)` for each chunk. The calling thread runs the
+// first chunk itself. If any chunk throws, the first exception is rethrown
+// after all workers have finished.
+template<typename F>
+void
+parallelFor(std::size_t count, unsigned threads, F&& fn) {
+  const unsigned workers = workerCount(count, threads);
+  if(workers == 1) {
+    fn(std::size_t(0), count, 0u);
+    return;
+  }
+
+  std::exception_ptr error;
+  std::mutex errorMutex;
+  auto run = [&](unsigned worker) {
+    const std::size_t begin = count * worker / workers;
+    const std::size_t end = count * (worker + 1) / workers;
+    try {
+      fn(begin, end, worker);
+    } catch(...) {
+      std::lock_guard lock(errorMutex);
+      if(!error) error = std::current_exception();
+    }
+  };
+
+  {
+    std::vector<std::jthread> pool;
+    pool.reserve(workers - 1);
+    for(unsigned worker = 1; worker < workers; worker++)
+      pool.emplace_back(run, worker);
+    run(0);
+  } // join
+
+  if(error) std::rethrow_exception(error);
+}
+
+} // namespace genpass::detail
+
+#endif // __GENPASS_UTIL_PARALLEL_HPP__
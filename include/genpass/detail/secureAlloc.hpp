@@ -0,0 +1,61 @@
+/* ---------------------------------------------------------------------- *\
+ * include/genpass/detail/secureAlloc.hpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#ifndef __GENPASS_UTIL_SECUREALLOC_HPP__
+#define __GENPASS_UTIL_SECUREALLOC_HPP__
+
+#include <cstddef>  // for size_t
+
+namespace genpass::detail {
+
+// Memory for secrets: seed material, key schedules and generated passwords.
+// It comes from pages that are locked into RAM where the system allows it,
+// and left out of core dumps, so it is never written to swap. Small sizes
+// are served from slots that are recycled within the pool rather than
+// handed back to the system, so a slot is never reused by the general heap.
+// Thread-safe.
+//
+// Returns zeroed memory, aligned for any type up to `size` bytes. Throws
+// std::bad_alloc if no pages can be had.
+void *secureAllocate(std::size_t size);
+// Zeroes and releases memory from secureAllocate of the same `size`.
+void secureRelease(void *p, std::size_t size) noexcept;
+
+// A fixed-size scratch buffer from secureAllocate, for secrets that would
+// otherwise be left on the stack.
+class SecureBuffer {
+public:
+  explicit SecureBuffer(std::size_t size)
+    : buf((unsigned char *)secureAllocate(size)), len(size)
+  { }
+  SecureBuffer(const SecureBuffer&) = delete;
+  ~SecureBuffer() { secureRelease(buf, len); }
+
+  unsigned char *data() const { return buf; }
+  std::size_t size() const { return len; }
+
+private:
+  unsigned char *const buf;
+  const std::size_t len;
+};
+
+} // namespace genpass::detail
+
+#endif // __GENPASS_UTIL_SECUREALLOC_HPP__
@@ -0,0 +1,424 @@
+/* ---------------------------------------------------------------------- *\
+ * src/Agent.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/Agent.hpp"
+
+#include <errno.h>            // for errno, EINTR, EEXIST, ECONNABORTED
+#include <fmt/format.h>       // for format
+#include <nlohmann/json.hpp>  // for basic_json
+#include <poll.h>             // for poll, pollfd, POLLIN
+#include <stdlib.h>           // for getenv
+#include <sys/socket.h>       // for socket, bind, listen, accept, connect
+#include <sys/stat.h>         // for umask, mkdir, lstat, S_ISDIR
+#include <sys/time.h>         // for timeval
+#include <sys/un.h>           // for sockaddr_un
+#include <unistd.h>           // for close, getuid, unlink
+#include <algorithm>          // for sort
+#include <cstdint>            // for uint32_t
+#include <cstring>            // for memcpy
+#include <list>               // for list
+#include <memory>             // for unique_ptr
+#include <mutex>              // for mutex, lock_guard
+#include <stdexcept>          // for runtime_error
+#include <system_error>       // for system_error, generic_category
+#include <thread>             // for thread
+
+namespace genpass {
+
+// larger messages are refused so that a client can't exhaust the agent
+static const std::uint32_t maxMessageLen = 64 << 20;
+static const int clientTimeoutSecs = 10;
+// further connections are closed right away
+static const std::size_t maxClients = 64;
+static const int pollIntervalMs = 250;
+
+static std::system_error
+sysError(const char *what) {
+  return std::system_error(errno, std::generic_category(), what);
+}
+
+static sockaddr_un
+makeAddress(const std::filesystem::path& socket) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  const std::string& str = socket.native();
+  if(str.length() >= sizeof(addr.sun_path))
+    throw std::runtime_error(fmt::format("socket path too long: {}", str));
+  std::memcpy(addr.sun_path, str.c_str(), str.length() + 1);
+  return addr;
+}
+
+static void
+writeAll(int fd, const void *buf, std::size_t len) {
+  const char *p = (const char *)buf;
+  while(len) {
+    const ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+    if(n < 0) {
+      if(errno == EINTR) continue;
+      throw sysError("failed to write to agent socket");
+    }
+    p += n;
+    len -= n;
+  }
+}
+
+// Returns false if the peer closed the connection before sending anything.
+static bool
+readAll(int fd, void *buf, std::size_t len) {
+  char *p = (char *)buf;
+  const std::size_t total = len;
+  while(len) {
+    const ssize_t n = recv(fd, p, len, 0);
+    if(n < 0) {
+      if(errno == EINTR) continue;
+      throw sysError("failed to read from agent socket");
+    }
+    if(n == 0) {
+      if(len == total) return false;
+      throw std::runtime_error("agent connection closed mid-message");
+    }
+    p += n;
+    len -= n;
+  }
+  return true;
+}
+
+static void
+sendMessage(int fd, const nlohmann::json& msg) {
+  const std::string body = msg.dump();
+  if(body.length() > maxMessageLen)
+    throw std::runtime_error("agent message too long");
+  unsigned char header[4];
+  for(int i = 0; i < 4; i++) header[i] = (unsigned char)(body.length() >> (8 * i));
+  writeAll(fd, header, sizeof(header));
+  writeAll(fd, body.data(), body.length());
+}
+
+static bool
+recvMessage(int fd, nlohmann::json& msg) {
+  unsigned char header[4];
+  if(!readAll(fd, header, sizeof(header))) return false;
+  std::uint32_t len = 0;
+  for(int i = 0; i < 4; i++) len |= (std::uint32_t)header[i] << (8 * i);
+  if(len > maxMessageLen)
+    throw std::runtime_error("agent message too long");
+
+  std::string body(len, '\0');
+  if(len && !readAll(fd, body.data(), len))
+    throw std::runtime_error("agent connection closed mid-message");
+  msg = nlohmann::json::parse(body);
+  return true;
+}
+
+static bool
+peerIsSameUser(int fd) {
+#ifdef SO_PEERCRED
+  struct ucred cred;
+  socklen_t len = sizeof(cred);
+  if(getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len)) return false;
+  return cred.uid == getuid();
+#else
+  uid_t uid;
+  gid_t gid;
+  if(getpeereid(fd, &uid, &gid)) return false;
+  return uid == getuid();
+#endif
+}
+
+// Throws unless the directory holding `socket` belongs to this user and
+// nobody else can write to it, so that nobody else can bind the socket
+// first or replace it. If `create`, a missing directory is made with mode
+// 0700 first.
+static void
+checkSocketDir(const std::filesystem::path& socket, bool create) {
+  std::filesystem::path dir = socket.parent_path();
+  if(dir.empty()) dir = ".";
+  if(create && mkdir(dir.c_str(), 0700) && errno != EEXIST)
+    throw sysError("failed to create agent socket directory");
+
+  struct stat st;
+  if(lstat(dir.c_str(), &st))
+    throw sysError("failed to stat agent socket directory");
+  if(!S_ISDIR(st.st_mode))
+    throw std::runtime_error(fmt::format(
+      "agent socket directory is not a directory: {}", dir.native()));
+  if(st.st_uid != getuid())
+    throw std::runtime_error(fmt::format(
+      "agent socket directory is owned by another user: {}", dir.native()));
+  if(st.st_mode & (S_IWGRP | S_IWOTH))
+    throw std::runtime_error(fmt::format(
+      "agent socket directory is writable by other users: {}", dir.native()));
+}
+
+std::filesystem::path
+defaultAgentSocket() {
+  if(const char *env = getenv("GENPASS_AGENT_SOCK"); env && *env)
+    return env;
+  if(const char *dir = getenv("XDG_RUNTIME_DIR"); dir && *dir)
+    return std::filesystem::path(dir) / "genpass-agent.sock";
+  // /tmp itself is shared, so the socket gets a private directory there
+  return fmt::format("/tmp/genpass-{}/agent.sock", getuid());
+}
+
+AgentServer::AgentServer(
+  const Seed& seed,
+  const std::filesystem::path& socket
+) : seed(seed), socketPath(socket), listenFd(-1), stopping(false) {
+  const sockaddr_un addr = makeAddress(socketPath);
+  checkSocketDir(socketPath, true);
+
+  listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if(listenFd < 0) throw sysError("failed to create agent socket");
+
+  // replace a stale socket, but not one that a live agent is listening on
+  if(std::filesystem::is_socket(socketPath)) {
+    const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    const bool live = probe >= 0
+      && !connect(probe, (const sockaddr *)&addr, sizeof(addr));
+    if(probe >= 0) close(probe);
+    if(live) {
+      close(listenFd);
+      throw std::runtime_error(fmt::format(
+        "an agent is already listening on {}", socketPath.native()));
+    }
+    unlink(socketPath.c_str());
+  }
+
+  // the socket must never be accessible to anyone else, even briefly
+  const mode_t oldMask = umask(0177);
+  const int bound = bind(listenFd, (const sockaddr *)&addr, sizeof(addr));
+  umask(oldMask);
+  if(bound || listen(listenFd, 16)) {
+    const std::system_error err = sysError("failed to bind agent socket");
+    close(listenFd);
+    throw err;
+  }
+}
+
+AgentServer::~AgentServer() {
+  close(listenFd);
+  unlink(socketPath.c_str());
+}
+
+namespace {
+
+struct Client {
+  std::thread thread;
+  std::atomic<bool> done{false};
+};
+
+} // namespace
+
+void
+AgentServer::serve() {
+  // each client gets a thread, so that one that stays connected can't keep
+  // the others waiting
+  std::list<Client> clients;
+  const auto joinClients = [&](bool all) {
+    for(auto it = clients.begin(); it != clients.end();) {
+      if(!all && !it->done) {
+        ++it;
+        continue;
+      }
+      it->thread.join();
+      it = clients.erase(it);
+    }
+  };
+
+  try {
+    while(!stopping) {
+      pollfd pfd{listenFd, POLLIN, 0};
+      const int ready = poll(&pfd, 1, pollIntervalMs);
+      if(ready < 0 && errno != EINTR) throw sysError("failed to poll");
+      joinClients(false);
+      if(ready <= 0) continue;
+
+      const int fd = accept4(listenFd, NULL, NULL, SOCK_CLOEXEC);
+      if(fd < 0) {
+        if(errno == EINTR || errno == ECONNABORTED) continue;
+        throw sysError("failed to accept agent connection");
+      }
+      if(!peerIsSameUser(fd) || clients.size() >= maxClients) {
+        close(fd);
+        continue;
+      }
+
+      // an idle or stuck client is dropped eventually
+      const timeval timeout{clientTimeoutSecs, 0};
+      setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+      setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+      Client& client = clients.emplace_back();
+      try {
+        client.thread = std::thread([this, fd, &client] {
+          try {
+            serveClient(fd);
+          } catch(const std::exception&) {
+            // drop the connection; the agent keeps going
+          }
+          close(fd);
+          client.done = true;
+        });
+      } catch(const std::system_error&) {
+        // out of threads; turn the client away like one over maxClients
+        clients.pop_back();
+        close(fd);
+      }
+    }
+  } catch(...) {
+    stopping = true;
+    joinClients(true);
+    throw;
+  }
+  joinClients(true);
+}
+
+void
+AgentServer::stop() {
+  stopping = true;
+}
+
+void
+AgentServer::serveClient(int fd) {
+  nlohmann::json request;
+  while(!stopping && recvMessage(fd, request)) {
+    nlohmann::json response;
+    try {
+      // clients share `genpass`, so only one request is handled at a time
+      std::lock_guard<std::mutex> lock(handleMutex);
+      response = handle(request);
+    } catch(const std::exception& e) {
+      response = {{"error", e.what()}};
+    }
+    sendMessage(fd, response);
+  }
+}
+
+nlohmann::json
+AgentServer::handle(const nlohmann::json& request) {
+  const std::string op = request.at("op").get<std::string>();
+
+  if(op == "generate") {
+    std::vector<std::unique_ptr<Password>> owned;
+    std::vector<const Password *> batch;
+    for(const auto& pwJson : request.at("passwords")) {
+      owned.push_back(genpass.constructPassword(pwJson));
+      if(!owned.back()) throw std::runtime_error(fmt::format(
+        "unknown algorithm: {}", pwJson.at("algorithm").get<std::string>()));
+      batch.push_back(owned.back().get());
+    }
+    return {{"passwords", genpass.generate(seed, batch)}};
+  }
+
+  if(op == "stop") {
+    stop();
+    return nlohmann::json::object();
+  }
+
+  throw std::runtime_error(fmt::format("unknown request: {}", op));
+}
+
+AgentClient::AgentClient(const std::filesystem::path& socket) {
+  const sockaddr_un addr = makeAddress(socket);
+  checkSocketDir(socket, false);
+  fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if(fd < 0) throw sysError("failed to create agent socket");
+  if(connect(fd, (const sockaddr *)&addr, sizeof(addr))) {
+    const std::system_error err = sysError("failed to connect to agent");
+    close(fd);
+    throw err;
+  }
+  // generated passwords must not be handed to whoever else is listening
+  if(!peerIsSameUser(fd)) {
+    close(fd);
+    throw std::runtime_error(fmt::format(
+      "agent on {} belongs to another user", socket.native()));
+  }
+}
+
+AgentClient::~AgentClient() {
+  close(fd);
+}
+
+std::string
+AgentClient::generate(const Password& password) {
+  return generate(std::vector<const Password *>{&password}).at(0);
+}
+
+std::vector<std::string>
+AgentClient::generate(const std::vector<const Password *>& passwords) {
+  nlohmann::json pwJson = nlohmann::json::array();
+  for(const Password *password : passwords)
+    pwJson.push_back(password->serialize());
+
+  const nlohmann::json response =
+    request({{"op", "generate"}, {"passwords", std::move(pwJson)}});
+  auto ret = response.at("passwords").get<std::vector<std::string>>();
+  if(ret.size() != passwords.size())
+    throw std::runtime_error("agent returned the wrong number of passwords");
+  return ret;
+}
+
+std::vector<std::string>
+AgentClient::generate(
+  const Genpass& genpass,
+  const std::vector<std::string>& ids
+) {
+  std::vector<const Password *> batch;
+  batch.reserve(ids.size());
+  for(const std::string& id : ids)
+    batch.push_back(&genpass.getPassword(id));
+  return generate(batch);
+}
+
+std::vector<std::pair<std::string, std::string>>
+AgentClient::generateAll(const Genpass& genpass) {
+  std::vector<const Password *> batch;
+  for(auto it = genpass.passwords_cbegin(); it != genpass.passwords_cend(); ++it)
+    batch.push_back(&*it);
+  std::sort(batch.begin(), batch.end(),
+    [](const Password *a, const Password *b) { return a->id < b->id; });
+
+  std::vector<std::string> generated = generate(batch);
+
+  std::vector<std::pair<std::string, std::string>> ret;
+  ret.reserve(batch.size());
+  for(std::size_t i = 0; i < batch.size(); i++)
+    ret.emplace_back(batch[i]->id, std::move(generated[i]));
+  return ret;
+}
+
+void
+AgentClient::stopAgent() {
+  request({{"op", "stop"}});
+}
+
+nlohmann::json
+AgentClient::request(const nlohmann::json& req) {
+  sendMessage(fd, req);
+  nlohmann::json response;
+  if(!recvMessage(fd, response))
+    throw std::runtime_error("agent closed the connection");
+  if(response.contains("error"))
+    throw std::runtime_error(fmt::format("agent error: {}",
+      response.at("error").get<std::string>()));
+  return response;
+}
+
+} // namespace genpass
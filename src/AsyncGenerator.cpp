@@ -0,0 +1,202 @@
+/* ---------------------------------------------------------------------- *\
+ * src/AsyncGenerator.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/AsyncGenerator.hpp"
+
+#include <algorithm>   // for stable_sort, min
+#include <cstdint>     // for SIZE_MAX
+#include <functional>  // for less
+#include <iterator>    // for back_inserter
+#include <stdexcept>   // for invalid_argument
+#include <utility>     // for move
+
+#include "genpass/SecureString.hpp"          // for SecureString
+#include "genpass/detail/generateBatch.hpp"  // for generateBatch
+#include "genpass/detail/instrument.hpp"     // for GENPASS_COUNT
+#include "genpass/detail/parallel.hpp"       // for workerCount
+
+namespace genpass {
+
+// The most generate requests a worker takes at once. Enough to fill the
+// multi-buffer HMAC several times over, few enough that one worker does not
+// take all of a burst while the others idle.
+static const std::size_t maxBatch = 64;
+
+AsyncGenerator::AsyncGenerator(unsigned threads) {
+  const unsigned count = detail::workerCount(SIZE_MAX, threads);
+  workers.reserve(count);
+  for(unsigned i = 0; i < count; i++)
+    workers.emplace_back([this] { work(); });
+}
+
+AsyncGenerator::~AsyncGenerator() {
+  {
+    const std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  workers.clear(); // join
+}
+
+std::future<std::string>
+AsyncGenerator::generate(
+  std::shared_ptr<const Seed> seed,
+  std::shared_ptr<const Password> password
+) {
+  auto promise = std::make_shared<std::promise<std::string>>();
+  std::future<std::string> ret = promise->get_future();
+  generate(std::move(seed), std::move(password),
+    [promise](std::string&& result, std::exception_ptr error) {
+      if(error) promise->set_exception(error);
+      else promise->set_value(std::move(result));
+    });
+  return ret;
+}
+
+void
+AsyncGenerator::generate(
+  std::shared_ptr<const Seed> seed,
+  std::shared_ptr<const Password> password,
+  GenerateCallback done
+) {
+  // a worker would dereference these, far from the caller
+  if(!seed || !password || !done)
+    throw std::invalid_argument("null seed, password or callback");
+  {
+    const std::lock_guard<std::mutex> lock(mutex);
+    requests.push_back({std::move(seed), std::move(password), std::move(done)});
+  }
+  wake.notify_one();
+}
+
+std::future<std::shared_ptr<const Seed>>
+AsyncGenerator::loadSeed(
+  const std::filesystem::path& file,
+  const std::string& password
+) {
+  auto promise = std::make_shared<std::promise<std::shared_ptr<const Seed>>>();
+  std::future<std::shared_ptr<const Seed>> ret = promise->get_future();
+  loadSeed(file, password,
+    [promise](std::shared_ptr<const Seed>&& seed, std::exception_ptr error) {
+      if(error) promise->set_exception(error);
+      else promise->set_value(std::move(seed));
+    });
+  return ret;
+}
+
+void
+AsyncGenerator::loadSeed(
+  const std::filesystem::path& file,
+  const std::string& password,
+  SeedCallback done
+) {
+  // a SecureString is wiped wherever the task moves it
+  submit([file, password = SecureString(password), done = std::move(done)] {
+    std::shared_ptr<const Seed> seed;
+    std::exception_ptr error;
+    try {
+      seed = Seed::sharedFromEncryptedFile(file, password);
+    } catch(...) {
+      error = std::current_exception();
+    }
+    done(std::move(seed), error);
+  });
+}
+
+void
+AsyncGenerator::submit(std::function<void()>&& task) {
+  {
+    const std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(std::move(task));
+  }
+  wake.notify_one();
+}
+
+void
+AsyncGenerator::work() {
+  std::vector<Request> batch;
+  for(;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [this] {
+        return stopping || !tasks.empty() || !requests.empty();
+      });
+      if(!tasks.empty()) {
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      } else if(!requests.empty()) {
+        const std::size_t n = std::min(requests.size(), maxBatch);
+        std::move(requests.begin(), requests.begin() + n,
+          std::back_inserter(batch));
+        requests.erase(requests.begin(), requests.begin() + n);
+      } else {
+        return; // stopping, and nothing is left
+      }
+    }
+
+    if(task) {
+      task();
+    } else {
+      runBatch(batch);
+      batch.clear();
+    }
+  }
+}
+
+void
+AsyncGenerator::runBatch(std::vector<Request>& batch) {
+  GENPASS_COUNT("async.batch", batch.size());
+  std::stable_sort(batch.begin(), batch.end(),
+    [](const Request& a, const Request& b) {
+      return std::less<const Seed *>()(a.seed.get(), b.seed.get());
+    });
+
+  std::vector<const Password *> passwords;
+  for(std::size_t begin = 0, end; begin < batch.size(); begin = end) {
+    const Seed& seed = *batch[begin].seed;
+    passwords.clear();
+    for(end = begin; end < batch.size() && batch[end].seed.get() == &seed;
+        end++)
+      passwords.push_back(batch[end].password.get());
+
+    std::vector<std::string> generated;
+    try {
+      generated = detail::generateBatch(seed, passwords, 1);
+    } catch(...) {
+      // find out which of them failed, and why
+      for(std::size_t i = begin; i < end; i++) {
+        std::string result;
+        std::exception_ptr error;
+        try {
+          result = batch[i].password->generate(seed);
+        } catch(...) {
+          error = std::current_exception();
+        }
+        batch[i].done(std::move(result), error);
+      }
+      continue;
+    }
+    for(std::size_t i = begin; i < end; i++)
+      batch[i].done(std::move(generated[i - begin]), NULL);
+  }
+}
+
+} // namespace genpass
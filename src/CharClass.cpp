@@ -0,0 +1,134 @@
+/* ---------------------------------------------------------------------- *\
+ * src/CharClass.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/CharClass.hpp"
+
+#include <bit>      // for countr_one, popcount
+#include <cstring>  // for memcpy
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define GENPASS_HAVE_AVX2_KERNEL 1
+#endif
+
+namespace genpass {
+
+// Computes which of 32 chars are members, as a bitmask.
+using MatchKernel = std::uint32_t (*)(const CharClass&, const char *);
+
+struct CharClassKernels {
+  static std::uint32_t
+  scalar(const CharClass& cls, const char *p) {
+    std::uint32_t mask = 0;
+    for(int i = 0; i < 32; i++) mask |= (std::uint32_t)cls.contains(p[i]) << i;
+    return mask;
+  }
+
+#ifdef GENPASS_HAVE_AVX2_KERNEL
+  // Looks up the low nibble of each char in the nibble table for its top
+  // bit, and tests the bit for the rest of its high nibble.
+  __attribute__((target("avx2"))) static std::uint32_t
+  avx2(const CharClass& cls, const char *p) {
+    const __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i lo = _mm256_and_si256(v, nibble);
+    const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+
+    const __m256i table0 = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i *)cls.nibbles[0]));
+    const __m256i table1 = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i *)cls.nibbles[1]));
+    const __m256i rows = _mm256_blendv_epi8(_mm256_shuffle_epi8(table0, lo),
+      _mm256_shuffle_epi8(table1, lo), v);
+
+    const __m256i bitOf = _mm256_setr_epi8(
+      1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+      1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m256i bit = _mm256_shuffle_epi8(bitOf, hi);
+    return (std::uint32_t)_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(_mm256_and_si256(rows, bit), bit));
+  }
+#endif
+
+  static MatchKernel
+  choose() {
+#ifdef GENPASS_HAVE_AVX2_KERNEL
+    if(__builtin_cpu_supports("avx2")) return &avx2;
+#endif
+    return &scalar;
+  }
+};
+
+static MatchKernel
+matchKernel() {
+  static const MatchKernel kernel = CharClassKernels::choose();
+  return kernel;
+}
+
+std::size_t
+CharClass::countIn(std::string_view s) const {
+  const MatchKernel match = matchKernel();
+  std::size_t ret = 0;
+  std::size_t i = 0;
+  for(; i + 32 <= s.size(); i += 32)
+    ret += std::popcount(match(*this, s.data() + i));
+  for(; i < s.size(); i++) ret += contains(s[i]);
+  return ret;
+}
+
+std::size_t
+CharClass::span(std::string_view s) const {
+  const MatchKernel match = matchKernel();
+  std::size_t i = 0;
+  for(; i + 32 <= s.size(); i += 32) {
+    const std::uint32_t mask = match(*this, s.data() + i);
+    if(mask != 0xffffffff) return i + std::countr_one(mask);
+  }
+  for(; i < s.size() && contains(s[i]); i++) { }
+  return i;
+}
+
+std::size_t
+CharClass::copyWithout(std::string_view in, char *out, std::size_t cap) const {
+  const MatchKernel match = matchKernel();
+  std::size_t n = 0;
+  std::size_t i = 0;
+  for(; i + 32 <= in.size() && cap - n >= 32; i += 32) {
+    const std::uint32_t mask = match(*this, in.data() + i);
+    if(!mask) {
+      // nothing to drop, which is the usual case
+      std::memcpy(out + n, in.data() + i, 32);
+      n += 32;
+      continue;
+    }
+    // store every char, but only advance past the ones that are kept
+    for(int j = 0; j < 32; j++) {
+      out[n] = in[i + j];
+      n += !((mask >> j) & 1);
+    }
+  }
+  for(; i < in.size() && n < cap; i++) {
+    out[n] = in[i];
+    n += !contains(in[i]);
+  }
+  return n;
+}
+
+} // namespace genpass
@@ -23,95 +23,576 @@
 #include <fmt/base.h>    // for println
 #include <fmt/format.h>  // for native_formatter::format
 #include <stdio.h>       // for stderr
+#include <algorithm>     // for sort
+#include <exception>     // for exception_ptr, current_exception, rethrow...
+#include <fstream>       // for ifstream
+#include <ostream>       // for ostream, operator<<
+#include <stdexcept>     // for invalid_argument, out_of_range
+#include <string_view>   // for string_view
+#include <unordered_set> // for unordered_set
 #include <utility>       // for move, pair
 
+#include "genpass/detail/IdIndex.hpp"     // for IdIndex
+#include "genpass/detail/VaultPolicies.hpp"  // for VaultPolicies
+#include "genpass/detail/atomicWrite.hpp"  // for atomicWrite
 #include "genpass/detail/fmt_nlohmann.hpp"
+#include "genpass/detail/generateBatch.hpp"  // for generateBatch, generateB...
+#include "genpass/detail/instrument.hpp"  // for GENPASS_COUNT, GENPASS_TIME
+#include "genpass/detail/parallel.hpp"    // for parallelFor, workerCount
 #include "genpass/Password.hpp"  // for Password
 
 namespace genpass {
 
-Genpass::Genpass() {
-  // register the default algorithm
+// Below this many entries per worker, starting the threads costs more than
+// they save.
+static const std::size_t minLoadPerWorker = 256;
+
+Genpass::Genpass()
+  : snapshot(std::make_shared<const Snapshot>(Snapshot::Entries(), 0, 0))
+{
+  // register the built-in algorithms
   PasswordV2::registerWith(*this);
+  PasswordV3::registerWith(*this);
 }
 
-Genpass::~Genpass() = default;
+Genpass::~Genpass() {
+  destroyPasswords();
+}
 
 Password&
 Genpass::addPassword(std::unique_ptr<Password>&& password) {
-  const auto res = passwords.insert({password->id, std::move(password)});
-  if(!res.second) throw std::runtime_error("password with ID already exists");
-  return *res.first->second;
+  heapOwned.insert(password.get());
+  return insertPassword(password.release());
 }
 
 Password&
 Genpass::newPassword(const std::string& algorithm, const std::string& id) {
-  const std::function<Password *()>& alg = algorithms.at(algorithm);
-  std::unique_ptr<Password> password(alg());
+  Password *password = construct(algorithms.at(algorithm));
   password->id = id;
-  return addPassword(std::move(password));
+  return insertPassword(password);
 }
 
 Password&
-Genpass::getPassword(const std::string& id) const {
-  return *passwords.at(id);
+Genpass::getPassword(std::string_view id) const {
+  Password *password = passwords.find(id);
+  if(!password)
+    throw std::out_of_range(fmt::format("no password with ID: {}", id));
+  return *password;
+}
+
+Password *
+Genpass::findPassword(std::string_view id) const {
+  return passwords.find(id);
 }
 
 void
-Genpass::removePassword(const std::string& id) {
-  if(!passwords.erase(id))
+Genpass::removePassword(std::string_view id) {
+  if(!erasePassword(id))
     throw std::out_of_range(fmt::format("no password with ID: {}", id));
+  if(listener) listener->passwordRemoved(std::string(id));
 }
 
-template<>
 void
-Genpass::deserialize<nlohmann::json>(nlohmann::json&& in) {
-  bool unknownAlg = false;
+Genpass::updateId(std::string_view oldId) {
+  Password *password = passwords.findStale(oldId);
+  if(!password)
+    throw std::out_of_range(fmt::format("no password with ID: {}", oldId));
+  if(password->id == oldId) return;
+  if(passwords.find(password->id))
+    throw std::runtime_error("password with ID already exists");
+
+  passwords.erase(password, detail::PasswordTable::hashId(oldId));
+  passwords.insert(password);
+  unpublish(password);
+  if(index) {
+    index->erase(oldId, password);
+    index->insert(password);
+  }
+  if(listener) listener->passwordsRenamed({{std::string(oldId), password}});
+}
+
+void
+Genpass::updateAllIds() {
+  // take every stale entry out first, so that IDs may be swapped around
+  const auto stale = passwords.extractStale();
+  if(stale.empty()) return;
 
-  for(const auto& pwJson : in.at("passwords")) {
-    std::string algName = pwJson.at("algorithm").get<std::string>();
+  std::unordered_set<std::string_view> newIds;
+  bool conflict = false;
+  for(const auto& entry : stale) {
+    const std::string& id = entry.first->id;
+    if(passwords.find(id) || !newIds.insert(id).second) conflict = true;
+  }
+  if(conflict) {
+    for(const auto& entry : stale) passwords.insert(entry.first, entry.second);
+    throw std::runtime_error("password with ID already exists");
+  }
 
-    auto algorithmLookup = algorithms.find(algName);
-    if(algorithmLookup == algorithms.end()) {
-      unknownAlg = true;
-      fmt::println(stderr, "error: unknown algorithm for %s: %s",
-        pwJson.at("id"), algName);
-      continue;
+  for(const auto& entry : stale) {
+    passwords.insert(entry.first);
+    unpublish(entry.first);
+  }
+  if(index) index->update();
+  if(listener) listener->passwordsReindexed();
+}
+
+void
+Genpass::markModified(const Password& password) {
+  unpublish(&password);
+  if(listener) listener->passwordPut(password);
+}
+
+void
+Genpass::publish() {
+  Snapshot::Entries entries;
+  entries.reserve(passwords.size());
+  std::unordered_map<const Password *, std::shared_ptr<const Password>> next;
+  next.reserve(passwords.size());
+  for(const Password *password : passwords) {
+    const auto old = published.find(password);
+    std::shared_ptr<const Password> copy;
+    if(old != published.end()) {
+      copy = std::move(old->second);
+    } else {
+      GENPASS_COUNT("alloc.snapshotCopy", 0);
+      copy = password->clone();
     }
-    std::function<Password *()>& algorithm = algorithmLookup->second;
+    next.emplace(password, copy);
+    entries.push_back(std::move(copy));
+  }
+  std::sort(entries.begin(), entries.end(),
+    [](const auto& a, const auto& b) { return a->id < b->id; });
+
+  published = std::move(next);
+  snapshot.store(std::make_shared<const Snapshot>(std::move(entries),
+    ++snapshotVersion, threadCount), std::memory_order_release);
+}
 
-    std::unique_ptr<Password> password(algorithm());
+std::vector<std::string>
+Genpass::generate(
+  const Seed& seed,
+  const std::vector<std::string>& ids
+) const {
+  std::vector<const Password *> batch;
+  batch.reserve(ids.size());
+  for(const std::string& id : ids)
+    batch.push_back(&getPassword(id));
+  return detail::generateBatch(seed, batch, threadCount);
+}
+
+std::vector<std::string>
+Genpass::generate(
+  const Seed& seed,
+  const std::vector<const Password *>& batch
+) const {
+  return detail::generateBatch(seed, batch, threadCount);
+}
+
+std::vector<SecureString>
+Genpass::generateSecure(
+  const Seed& seed,
+  const std::vector<std::string>& ids
+) const {
+  std::vector<const Password *> batch;
+  batch.reserve(ids.size());
+  for(const std::string& id : ids)
+    batch.push_back(&getPassword(id));
+  return detail::generateBatchSecure(seed, batch, threadCount);
+}
+
+std::vector<SecureString>
+Genpass::generateSecure(
+  const Seed& seed,
+  const std::vector<const Password *>& batch
+) const {
+  return detail::generateBatchSecure(seed, batch, threadCount);
+}
+
+std::vector<std::pair<std::string, std::string>>
+Genpass::generateAll(const Seed& seed) const {
+  std::vector<const Password *> batch;
+  batch.reserve(passwords.size());
+  for(const Password *password : passwords)
+    batch.push_back(password);
+  std::sort(batch.begin(), batch.end(),
+    [](const Password *a, const Password *b) { return a->id < b->id; });
+
+  std::vector<std::string> generated = detail::generateBatch(seed, batch, threadCount);
+
+  std::vector<std::pair<std::string, std::string>> ret;
+  ret.reserve(batch.size());
+  for(std::size_t i = 0; i < batch.size(); i++)
+    ret.emplace_back(batch[i]->id, std::move(generated[i]));
+  return ret;
+}
+
+ReverseIndex
+Genpass::reverseIndex(
+  const Seed& seed,
+  std::int32_t firstSerial,
+  std::int32_t lastSerial
+) const {
+  if(firstSerial > lastSerial)
+    throw std::invalid_argument("serial window is empty");
+
+  // generate from copies, so that the serials can be changed
+  std::vector<std::unique_ptr<Password>> copies;
+  copies.reserve(passwords.size());
+  for(const Password *password : passwords)
+    copies.push_back(password->clone());
+  std::sort(copies.begin(), copies.end(),
+    [](const auto& a, const auto& b) { return a->id < b->id; });
+
+  std::vector<std::string> ids;
+  std::vector<const Password *> batch;
+  ids.reserve(copies.size());
+  batch.reserve(copies.size());
+  for(const auto& copy : copies) {
+    ids.push_back(copy->id);
+    batch.push_back(copy.get());
+  }
+
+  ReverseIndex ret(std::move(ids), firstSerial, lastSerial);
+  for(std::int64_t serial = firstSerial; serial <= lastSerial; serial++) {
+    for(const auto& copy : copies) copy->serial = (std::int32_t)serial;
+    ret.add(detail::generateBatchSecure(seed, batch, threadCount),
+      (std::int32_t)serial, threadCount);
+  }
+  return ret;
+}
+
+std::unique_ptr<Password>
+Genpass::constructPassword(const nlohmann::json& json) const {
+  const auto algorithmLookup =
+    algorithms.find(json.at("algorithm").get<std::string>());
+  if(algorithmLookup == algorithms.end()) return nullptr;
+
+  std::unique_ptr<Password> password(algorithmLookup->second.create());
+  password->deserialize(json);
+  return password;
+}
+
+Password *
+Genpass::loadPassword(const nlohmann::json& pwJson) {
+  Password *password = buildPassword(pwJson);
+  if(!password) {
+    fmt::println(stderr, "error: unknown algorithm for {}: {}",
+      pwJson.at("id"), pwJson.at("algorithm").get<std::string>());
+    return NULL;
+  }
+  return &insertPassword(password);
+}
+
+Password *
+Genpass::buildPassword(const nlohmann::json& pwJson) {
+  const auto algorithmLookup =
+    algorithms.find(pwJson.at("algorithm").get<std::string>());
+  if(algorithmLookup == algorithms.end()) return NULL;
+
+  GENPASS_COUNT("vault.entry", 0);
+  Password *password = construct(algorithmLookup->second);
+  try {
     password->deserialize(pwJson);
-    addPassword(std::move(password));
+  } catch(...) {
+    destroy(password);
+    throw;
+  }
+  return password;
+}
+
+Password *
+Genpass::construct(const Algorithm& algorithm) {
+  if(algorithm.emplace) {
+    GENPASS_COUNT("alloc.passwordArena", 0);
+    return algorithm.emplace(arena);
+  }
+
+  GENPASS_COUNT("alloc.passwordHeap", 0);
+  std::unique_ptr<Password> password(algorithm.create());
+  heapOwned.insert(password.get());
+  return password.release();
+}
+
+bool
+Genpass::loadPasswords(
+  nlohmann::json::array_t& entries,
+  const nlohmann::json *policies
+) {
+  struct Built {
+    Password *password = NULL;
+    bool onHeap = false;
+    std::size_t hash = 0;
+    std::exception_ptr error;
+  };
+  const auto discard = [](Built& built) {
+    if(built.onHeap) delete built.password;
+    else if(built.password) built.password->~Password();
+  };
+
+  // build the passwords, each worker in its own arena
+  const unsigned workers = detail::workerCount(
+    entries.size() / minLoadPerWorker, threadCount);
+  while(workerArenas.size() < workers - 1) workerArenas.emplace_back();
+  std::vector<Built> built(entries.size());
+  detail::parallelFor(entries.size(), workers,
+    [&](std::size_t begin, std::size_t end, unsigned worker) {
+      std::pmr::memory_resource& workerArena =
+        worker ? workerArenas[worker - 1] : arena;
+      for(std::size_t i = begin; i < end; i++) {
+        nlohmann::json& entry = entries[i];
+        Built& out = built[i];
+        try {
+          if(policies) detail::VaultPolicies::expand(entry, *policies);
+          const auto algorithmLookup =
+            algorithms.find(entry.at("algorithm").get<std::string>());
+          if(algorithmLookup == algorithms.end()) continue;
+
+          GENPASS_COUNT("vault.entry", 0);
+          const Algorithm& algorithm = algorithmLookup->second;
+          if(algorithm.emplace) {
+            GENPASS_COUNT("alloc.passwordArena", 0);
+            out.password = algorithm.emplace(workerArena);
+          } else {
+            GENPASS_COUNT("alloc.passwordHeap", 0);
+            out.password = algorithm.create();
+            out.onHeap = true;
+          }
+          out.password->deserialize(entry);
+          out.hash = detail::PasswordTable::hashId(out.password->id);
+        } catch(...) {
+          discard(out);
+          out = Built();
+          out.error = std::current_exception();
+        }
+      }
+    }
+  );
+
+  // add them in order, stopping at the first error as loadPassword would
+  bool allKnown = true;
+  passwords.reserve(passwords.size() + entries.size());
+  std::size_t i = 0;
+  try {
+    for(; i < built.size(); i++) {
+      Built& out = built[i];
+      if(out.error) std::rethrow_exception(out.error);
+      if(!out.password) {
+        fmt::println(stderr, "error: unknown algorithm for {}: {}",
+          entries[i].at("id"), entries[i].at("algorithm").get<std::string>());
+        allKnown = false;
+        continue;
+      }
+      if(out.onHeap) heapOwned.insert(out.password);
+      Password *password = out.password;
+      out.password = NULL;
+      insertPassword(password, out.hash);
+    }
+  } catch(...) {
+    for(; i < built.size(); i++) discard(built[i]);
+    throw;
+  }
+  return allKnown;
+}
+
+Password&
+Genpass::insertPassword(Password *password) {
+  return insertPassword(password, detail::PasswordTable::hashId(password->id));
+}
+
+Password&
+Genpass::insertPassword(Password *password, std::size_t hash) {
+  if(!passwords.insert(password, hash)) {
+    destroy(password);
+    throw std::runtime_error("password with ID already exists");
   }
+  if(index) index->insert(password);
+  if(listener && !loading) listener->passwordPut(*password);
+  return *password;
+}
 
-  if(unknownAlg) {
-    fmt::println(stderr,
-      "error: Some passwords could not be loaded because there is no loader."
-      " This could happen if a plugin is missing.");
+void
+Genpass::loadInBulk(const std::function<void()>& load) {
+  // a nested load is part of the outer one
+  if(loading) return load();
+
+  const std::size_t before = passwords.size();
+  loading = true;
+  try {
+    load();
+  } catch(...) {
+    loading = false;
+    if(listener && passwords.size() != before) listener->passwordsLoaded();
+    throw;
   }
+  loading = false;
+  if(listener && passwords.size() != before) listener->passwordsLoaded();
+}
+
+bool
+Genpass::erasePassword(std::string_view id) {
+  Password *password = passwords.findStale(id);
+  if(!password) return false;
+  passwords.erase(password, detail::PasswordTable::hashId(id));
+  if(index) index->erase(id, password);
+  destroy(password);
+  return true;
+}
+
+void
+Genpass::destroy(Password *password) {
+  unpublish(password);
+  if(!heapOwned.empty() && heapOwned.erase(password)) {
+    delete password;
+  } else {
+    // the arena only reclaims memory as a whole, in destroyPasswords
+    password->~Password();
+  }
+}
+
+void
+Genpass::destroyPasswords() {
+  for(Password *password : passwords) destroy(password);
+  passwords.clear();
+  heapOwned.clear();
+  published.clear();
+  arena.release();
+  workerArenas.clear();
+  if(index) index->clear();
+}
+
+const detail::IdIndex&
+Genpass::searchIndex() const {
+  std::call_once(indexBuilt, [this] {
+    auto built = std::make_unique<detail::IdIndex>();
+    built->build(std::vector<Password *>(passwords.begin(), passwords.end()));
+    index = std::move(built);
+  });
+  return *index;
+}
+
+detail::PasswordRange
+Genpass::findByPrefix(std::string_view prefix) const {
+  return searchIndex().prefix(prefix);
+}
+
+detail::PasswordRange
+Genpass::findBySubstring(std::string_view needle) const {
+  return searchIndex().substring(needle);
+}
+
+detail::PasswordRange
+Genpass::findFuzzy(std::string_view id, unsigned maxEdits) const {
+  return searchIndex().fuzzy(id, maxEdits);
+}
+
+template<>
+void
+Genpass::deserialize<nlohmann::json>(nlohmann::json&& in) {
+  loadInBulk([&] {
+    const auto policies = in.find("policies");
+    if(!loadPasswords(
+        in.at("passwords").get_ref<nlohmann::json::array_t&>(),
+        policies != in.end() ? &*policies : NULL))
+      warnUnknownAlgorithms();
+  });
+}
+
+void
+Genpass::warnUnknownAlgorithms() {
+  fmt::println(stderr,
+    "error: Some passwords could not be loaded because there is no loader."
+    " This could happen if a plugin is missing.");
 }
 
 nlohmann::json
 Genpass::serialize() const {
+  detail::VaultPolicies policies;
+  for(const Password *password : passwords) policies.add(*password);
+
   nlohmann::json ret{};
+  ret["policies"] = policies.table();
   nlohmann::json& passwordsJson = ret["passwords"] = nlohmann::json::array({});
-  for(const auto& pwEntry : passwords) {
-    passwordsJson += pwEntry.second->serialize();
+  for(const Password *password : passwords) {
+    nlohmann::json entry = password->serialize();
+    policies.compact(*password, entry);
+    passwordsJson += std::move(entry);
   }
   return ret;
 }
 
+void
+Genpass::serializeTo(std::ostream& out) const {
+  // policies go first, so that a streaming loader has them for the entries
+  detail::VaultPolicies policies;
+  for(const Password *password : passwords) policies.add(*password);
+
+  out << "{\"policies\":" << policies.table() << ",\"passwords\":[";
+  bool first = true;
+  for(const Password *password : passwords) {
+    if(!first) out << ',';
+    first = false;
+    nlohmann::json entry = password->serialize();
+    policies.compact(*password, entry);
+    out << entry;
+  }
+  out << "]}\n";
+}
+
+void
+Genpass::serializeTo(std::ostream& out, VaultFormat format) const {
+  if(format == VaultFormat::json) return serializeTo(out);
+
+  // built in order, unlike serialize(), so that the policy table is
+  // written before the entries that refer to it
+  detail::VaultPolicies policies;
+  for(const Password *password : passwords) policies.add(*password);
+
+  nlohmann::ordered_json vault;
+  vault["policies"] = policies.table();
+  nlohmann::ordered_json& passwordsJson = vault["passwords"] =
+    nlohmann::ordered_json::array();
+  for(const Password *password : passwords) {
+    nlohmann::json entry = password->serialize();
+    policies.compact(*password, entry);
+    passwordsJson.push_back(nlohmann::ordered_json(entry));
+  }
+  detail::writeVault(vault, out, format);
+}
+
+void
+Genpass::saveTo(const std::filesystem::path& file, VaultFormat format) const {
+  GENPASS_TIME("vault.save", 0);
+  detail::atomicWrite(file,
+    [&](std::ostream& out) { serializeTo(out, format); });
+}
+
+VaultFormat
+Genpass::loadFrom(const std::filesystem::path& file) {
+  const VaultFormat format = detectVaultFormat(file);
+  std::ifstream in(file, std::ios_base::binary);
+  if(!in) throw std::runtime_error(
+    fmt::format("failed to open {}", file.native()));
+  GENPASS_TIME("vault.load", std::filesystem::file_size(file));
+  deserialize(in, format);
+  return format;
+}
+
 void
 Genpass::clearPasswords() {
-  passwords.clear();
+  destroyPasswords();
+  if(listener) listener->passwordsCleared();
 }
 
 void
 Genpass::registerAlgorithm(const std::string& name,
   std::function<Password *()> constructor
 ) {
-  const auto res = algorithms.insert({name, constructor});
+  addAlgorithm(name, {std::move(constructor), NULL});
+}
+
+void
+Genpass::addAlgorithm(const std::string& name, Algorithm&& algorithm) {
+  const auto res = algorithms.insert({name, std::move(algorithm)});
   if(!res.second) throw std::runtime_error(fmt::format(
     "algorithm already exists: {}",
     name
@@ -0,0 +1,424 @@
+/* ---------------------------------------------------------------------- *\
+ * src/HmacSha256.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/detail/HmacSha256.hpp"
+
+#include <openssl/crypto.h>  // for OPENSSL_cleanse
+#include <algorithm>         // for max, min
+#include <cassert>           // for assert
+#include <cstring>           // for memcpy, memset, memcmp
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define GENPASS_HAVE_AVX2_KERNEL 1
+#endif
+
+#include "genpass/detail/secureAlloc.hpp"  // for secureAllocate, secureRel...
+
+namespace genpass::detail {
+
+namespace {
+
+constexpr std::size_t blockSize = 64;
+constexpr std::size_t lanes = HmacSha256::lanes;
+
+constexpr std::uint32_t iv[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+  0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+constexpr std::uint32_t k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+  0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+  0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+  0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+  0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+  0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// Lane-interleaved state and message words: [word][lane].
+struct LaneWords {
+  alignas(32) std::uint32_t w[16][lanes];
+};
+struct LaneState {
+  alignas(32) std::uint32_t h[8][lanes];
+};
+
+// Runs one compression on every lane whose bit is set in `active`.
+using Kernel = void (*)(LaneState& st, const LaneWords& w, unsigned active);
+
+inline std::uint32_t
+rotr(std::uint32_t x, int n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+inline std::uint32_t
+loadBe32(const unsigned char *p) {
+  return (std::uint32_t)p[0] << 24 | (std::uint32_t)p[1] << 16
+    | (std::uint32_t)p[2] << 8 | (std::uint32_t)p[3];
+}
+
+inline void
+storeBe32(unsigned char *p, std::uint32_t x) {
+  p[0] = (unsigned char)(x >> 24);
+  p[1] = (unsigned char)(x >> 16);
+  p[2] = (unsigned char)(x >> 8);
+  p[3] = (unsigned char)x;
+}
+
+void
+compress(std::uint32_t st[8], const std::uint32_t block[16]) {
+  std::uint32_t w[64];
+  std::memcpy(w, block, sizeof(std::uint32_t) * 16);
+  for(int t = 16; t < 64; t++) {
+    const std::uint32_t s0 =
+      rotr(w[t - 15], 7) ^ rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+    const std::uint32_t s1 =
+      rotr(w[t - 2], 17) ^ rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+    w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+  }
+
+  std::uint32_t a = st[0], b = st[1], c = st[2], d = st[3];
+  std::uint32_t e = st[4], f = st[5], g = st[6], h = st[7];
+  for(int t = 0; t < 64; t++) {
+    const std::uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25))
+      + ((e & f) ^ (~e & g)) + k[t] + w[t];
+    const std::uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22))
+      + ((a & b) ^ (a & c) ^ (b & c));
+    h = g; g = f; f = e; e = d + t1;
+    d = c; c = b; b = a; a = t1 + t2;
+  }
+  st[0] += a; st[1] += b; st[2] += c; st[3] += d;
+  st[4] += e; st[5] += f; st[6] += g; st[7] += h;
+}
+
+void
+scalarKernel(LaneState& st, const LaneWords& w, unsigned active) {
+  for(std::size_t lane = 0; lane < lanes; lane++) {
+    if(!(active & (1u << lane))) continue;
+    std::uint32_t s[8], block[16];
+    for(int i = 0; i < 8; i++) s[i] = st.h[i][lane];
+    for(int i = 0; i < 16; i++) block[i] = w.w[i][lane];
+    compress(s, block);
+    for(int i = 0; i < 8; i++) st.h[i][lane] = s[i];
+  }
+}
+
+#ifdef GENPASS_HAVE_AVX2_KERNEL
+
+#define GENPASS_AVX2 __attribute__((target("avx2")))
+
+GENPASS_AVX2 inline __m256i
+rotr8(__m256i x, int n) {
+  return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+GENPASS_AVX2 inline __m256i
+xor3(__m256i a, __m256i b, __m256i c) {
+  return _mm256_xor_si256(_mm256_xor_si256(a, b), c);
+}
+
+GENPASS_AVX2 void
+avx2Kernel(LaneState& st, const LaneWords& words, unsigned active) {
+  __m256i w[64];
+  for(int t = 0; t < 16; t++)
+    w[t] = _mm256_load_si256((const __m256i *)words.w[t]);
+  for(int t = 16; t < 64; t++) {
+    const __m256i s0 = xor3(rotr8(w[t - 15], 7), rotr8(w[t - 15], 18),
+      _mm256_srli_epi32(w[t - 15], 3));
+    const __m256i s1 = xor3(rotr8(w[t - 2], 17), rotr8(w[t - 2], 19),
+      _mm256_srli_epi32(w[t - 2], 10));
+    w[t] = _mm256_add_epi32(_mm256_add_epi32(w[t - 16], s0),
+      _mm256_add_epi32(w[t - 7], s1));
+  }
+
+  __m256i s[8];
+  for(int i = 0; i < 8; i++)
+    s[i] = _mm256_load_si256((const __m256i *)st.h[i]);
+  __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+  __m256i e = s[4], f = s[5], g = s[6], h = s[7];
+  for(int t = 0; t < 64; t++) {
+    const __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f),
+      _mm256_andnot_si256(e, g));
+    const __m256i maj = xor3(_mm256_and_si256(a, b), _mm256_and_si256(a, c),
+      _mm256_and_si256(b, c));
+    const __m256i t1 = _mm256_add_epi32(
+      _mm256_add_epi32(h, xor3(rotr8(e, 6), rotr8(e, 11), rotr8(e, 25))),
+      _mm256_add_epi32(_mm256_add_epi32(ch, _mm256_set1_epi32((int)k[t])),
+        w[t]));
+    const __m256i t2 = _mm256_add_epi32(
+      xor3(rotr8(a, 2), rotr8(a, 13), rotr8(a, 22)), maj);
+    h = g; g = f; f = e; e = _mm256_add_epi32(d, t1);
+    d = c; c = b; b = a; a = _mm256_add_epi32(t1, t2);
+  }
+  const __m256i out[8] = {a, b, c, d, e, f, g, h};
+
+  // only lanes that still have blocks left take the new state
+  const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+  const __m256i mask = _mm256_cmpeq_epi32(
+    _mm256_and_si256(_mm256_set1_epi32((int)active), bits), bits);
+  for(int i = 0; i < 8; i++) {
+    const __m256i next = _mm256_add_epi32(s[i], out[i]);
+    _mm256_store_si256((__m256i *)st.h[i],
+      _mm256_blendv_epi8(s[i], next, mask));
+  }
+}
+
+#undef GENPASS_AVX2
+
+#endif // GENPASS_HAVE_AVX2_KERNEL
+
+struct KernelChoice {
+  Kernel kernel;
+  const char *name;
+};
+
+KernelChoice
+chooseKernel() {
+#ifdef GENPASS_HAVE_AVX2_KERNEL
+  if(__builtin_cpu_supports("avx2")) return {&avx2Kernel, "avx2"};
+#endif
+  return {&scalarKernel, "scalar"};
+}
+
+const KernelChoice&
+selectedKernel() {
+  static const KernelChoice choice = chooseKernel();
+  return choice;
+}
+
+// Writes block `b` of the SHA-256 padding of `msg` as big-endian words into
+// `lane` of `w`. `prefix` is the number of bytes already hashed before msg.
+void
+loadPaddedBlock(LaneWords& w, std::size_t lane, const unsigned char *msg,
+  std::size_t len, std::size_t prefix, std::size_t b, std::size_t blocks
+) {
+  unsigned char block[blockSize] = {};
+  const std::size_t off = b * blockSize;
+  if(off < len)
+    std::memcpy(block, msg + off, std::min(blockSize, len - off));
+  if(len >= off && len < off + blockSize)
+    block[len - off] = 0x80;
+  if(b == blocks - 1) {
+    const std::uint64_t bits = (std::uint64_t)(prefix + len) * 8;
+    storeBe32(block + 56, (std::uint32_t)(bits >> 32));
+    storeBe32(block + 60, (std::uint32_t)bits);
+  }
+  for(int i = 0; i < 16; i++)
+    w.w[i][lane] = loadBe32(block + 4 * i);
+  OPENSSL_cleanse(block, sizeof(block));
+}
+
+void
+runMulti(Kernel kernel, const std::uint32_t inner[8],
+  const std::uint32_t outer[8], std::size_t count,
+  const unsigned char *const *msgs, const std::size_t *lens,
+  unsigned char *const *outs
+) {
+  assert(count <= lanes);
+
+  // inner hash, continuing from the pre-hashed ipad block
+  LaneState st;
+  std::size_t blocks[lanes] = {};
+  std::size_t maxBlocks = 0;
+  for(std::size_t lane = 0; lane < lanes; lane++) {
+    for(int i = 0; i < 8; i++) st.h[i][lane] = inner[i];
+    if(lane < count) {
+      blocks[lane] = (lens[lane] + 9 + blockSize - 1) / blockSize;
+      maxBlocks = std::max(maxBlocks, blocks[lane]);
+    }
+  }
+  LaneWords w = {};
+  for(std::size_t b = 0; b < maxBlocks; b++) {
+    unsigned active = 0;
+    for(std::size_t lane = 0; lane < count; lane++) {
+      if(b >= blocks[lane]) continue;
+      loadPaddedBlock(w, lane, msgs[lane], lens[lane], blockSize, b,
+        blocks[lane]);
+      active |= 1u << lane;
+    }
+    kernel(st, w, active);
+  }
+
+  // outer hash over the inner digest, which is always a single block
+  for(int i = 0; i < 8; i++)
+    for(std::size_t lane = 0; lane < lanes; lane++)
+      w.w[i][lane] = st.h[i][lane];
+  for(std::size_t lane = 0; lane < lanes; lane++) {
+    w.w[8][lane] = 0x80000000;
+    for(int i = 9; i < 15; i++) w.w[i][lane] = 0;
+    w.w[15][lane] = (blockSize + HmacSha256::macSize) * 8;
+    for(int i = 0; i < 8; i++) st.h[i][lane] = outer[i];
+  }
+  kernel(st, w, (1u << count) - 1);
+
+  for(std::size_t lane = 0; lane < count; lane++)
+    for(int i = 0; i < 8; i++)
+      storeBe32(outs[lane] + 4 * i, st.h[i][lane]);
+
+  OPENSSL_cleanse(&st, sizeof(st));
+  OPENSSL_cleanse(&w, sizeof(w));
+}
+
+} // namespace
+
+HmacSha256::HmacSha256(const unsigned char *key, std::size_t keyLen) {
+  unsigned char k0[blockSize] = {};
+  if(keyLen > blockSize) {
+    // long keys are replaced by their hash
+    std::uint32_t st[8];
+    std::memcpy(st, iv, sizeof(st));
+    const std::size_t blocks = (keyLen + 9 + blockSize - 1) / blockSize;
+    for(std::size_t b = 0; b < blocks; b++) {
+      LaneWords w = {};
+      loadPaddedBlock(w, 0, key, keyLen, 0, b, blocks);
+      std::uint32_t block[16];
+      for(int i = 0; i < 16; i++) block[i] = w.w[i][0];
+      compress(st, block);
+      OPENSSL_cleanse(&w, sizeof(w));
+      OPENSSL_cleanse(block, sizeof(block));
+    }
+    for(int i = 0; i < 8; i++) storeBe32(k0 + 4 * i, st[i]);
+    OPENSSL_cleanse(st, sizeof(st));
+  } else {
+    std::memcpy(k0, key, keyLen);
+  }
+
+  std::uint32_t block[16];
+  std::memcpy(inner, iv, sizeof(inner));
+  for(int i = 0; i < 16; i++) block[i] = loadBe32(k0 + 4 * i) ^ 0x36363636;
+  compress(inner, block);
+  std::memcpy(outer, iv, sizeof(outer));
+  for(int i = 0; i < 16; i++) block[i] = loadBe32(k0 + 4 * i) ^ 0x5c5c5c5c;
+  compress(outer, block);
+
+  OPENSSL_cleanse(block, sizeof(block));
+  OPENSSL_cleanse(k0, sizeof(k0));
+}
+
+HmacSha256::~HmacSha256() {
+  OPENSSL_cleanse(inner, sizeof(inner));
+  OPENSSL_cleanse(outer, sizeof(outer));
+}
+
+void *
+HmacSha256::operator new(std::size_t size) {
+  return secureAllocate(size);
+}
+
+void
+HmacSha256::operator delete(void *p, std::size_t size) noexcept {
+  secureRelease(p, size);
+}
+
+void
+HmacSha256::mac(const unsigned char *msg, std::size_t len,
+  unsigned char *out
+) const {
+  runMulti(&scalarKernel, inner, outer, 1, &msg, &len, &out);
+}
+
+void
+HmacSha256::macMulti(std::size_t count, const unsigned char *const *msgs,
+  const std::size_t *lens, unsigned char *const *outs
+) const {
+  if(count == 1) return mac(msgs[0], lens[0], outs[0]);
+  runMulti(selectedKernel().kernel, inner, outer, count, msgs, lens, outs);
+}
+
+const char *
+HmacSha256::kernelName() {
+  return selectedKernel().name;
+}
+
+// Runs the selected kernel on RFC 4231, test cases 2 and 6.
+static bool
+passesTestVectors() {
+  static const unsigned char key6[131] = {
+    0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+    0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+    0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+    0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+    0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+    0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+    0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+    0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+    0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+    0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+    0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa
+  };
+  static const char msg2[] = "what do ya want for nothing?";
+  static const char msg6[] =
+    "Test Using Larger Than Block-Size Key - Hash Key First";
+  constexpr std::size_t macSize = HmacSha256::macSize;
+  static const unsigned char mac2[macSize] = {
+    0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e, 0x6a, 0x04, 0x24, 0x26,
+    0x08, 0x95, 0x75, 0xc7, 0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83,
+    0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43
+  };
+  static const unsigned char mac6[macSize] = {
+    0x60, 0xe4, 0x31, 0x59, 0x1e, 0xe0, 0xb6, 0x7f, 0x0d, 0x8a, 0x26, 0xaa,
+    0xcb, 0xf5, 0xb7, 0x7f, 0x8e, 0x0b, 0xc6, 0x21, 0x37, 0x28, 0xc5, 0x14,
+    0x05, 0x46, 0x04, 0x0f, 0x0e, 0xe3, 0x7f, 0x54
+  };
+
+  const HmacSha256 hmac2((const unsigned char *)"Jefe", 4);
+  const HmacSha256 hmac6(key6, sizeof(key6));
+
+  // run every lane of the selected kernel, including partial batches
+  const unsigned char *msgs[lanes];
+  std::size_t lens[lanes];
+  unsigned char outBuf[lanes][macSize];
+  unsigned char *outs[lanes];
+  for(std::size_t lane = 0; lane < lanes; lane++) {
+    msgs[lane] = (const unsigned char *)msg2;
+    lens[lane] = sizeof(msg2) - 1;
+    outs[lane] = outBuf[lane];
+  }
+  for(std::size_t count = 1; count <= lanes; count++) {
+    std::memset(outBuf, 0, sizeof(outBuf));
+    hmac2.macMulti(count, msgs, lens, outs);
+    for(std::size_t lane = 0; lane < count; lane++)
+      if(std::memcmp(outBuf[lane], mac2, macSize)) return false;
+  }
+
+  unsigned char out[macSize];
+  hmac6.mac((const unsigned char *)msg6, sizeof(msg6) - 1, out);
+  return !std::memcmp(out, mac6, macSize);
+}
+
+bool
+HmacSha256::selfTest() {
+  // the kernel is chosen once per process, so it need only be tested once
+  static const bool passed = passesTestVectors();
+  return passed;
+}
+
+} // namespace genpass::detail
@@ -0,0 +1,330 @@
+/* ---------------------------------------------------------------------- *\
+ * src/IdIndex.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/detail/IdIndex.hpp"
+
+#include <algorithm>  // for sort, unique, lower_bound, partition_point, min
+#include <memory>     // for make_shared, make_unique
+#include <utility>    // for move
+
+#include "genpass/Password.hpp"  // for Password
+
+namespace genpass::detail {
+
+static std::uint32_t
+trigram(const char *s) {
+  return (std::uint32_t)(unsigned char)s[0] << 16
+    | (std::uint32_t)(unsigned char)s[1] << 8
+    | (std::uint32_t)(unsigned char)s[2];
+}
+
+// The distinct trigrams of `id`.
+static std::vector<std::uint32_t>
+trigrams(std::string_view id) {
+  std::vector<std::uint32_t> ret;
+  for(std::size_t i = 0; i + 3 <= id.size(); i++)
+    ret.push_back(trigram(id.data() + i));
+  std::sort(ret.begin(), ret.end());
+  ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+  return ret;
+}
+
+IdIndex::~IdIndex() = default;
+
+void
+IdIndex::build(const std::vector<Password *>& passwords) {
+  clear();
+  sorted.reserve(passwords.size());
+  for(Password *password : passwords)
+    sorted.push_back(std::make_unique<Entry>(Entry{password->id, password}));
+  std::sort(sorted.begin(), sorted.end(),
+    [](const auto& a, const auto& b) { return a->id < b->id; });
+  for(const auto& entry : sorted) addGrams(entry.get());
+}
+
+std::size_t
+IdIndex::lowerBound(std::string_view id) const {
+  return std::lower_bound(sorted.begin(), sorted.end(), id,
+    [](const auto& entry, std::string_view id) { return entry->id < id; })
+    - sorted.begin();
+}
+
+void
+IdIndex::insert(Password *password) {
+  auto entry = std::make_unique<Entry>(Entry{password->id, password});
+  addGrams(entry.get());
+  sorted.insert(sorted.begin() + lowerBound(entry->id), std::move(entry));
+}
+
+void
+IdIndex::erase(std::string_view id, const Password *password) {
+  for(std::size_t i = lowerBound(id);
+      i < sorted.size() && sorted[i]->id == id; i++) {
+    if(sorted[i]->password != password) continue;
+    removeGrams(sorted[i].get());
+    sorted.erase(sorted.begin() + i);
+    return;
+  }
+}
+
+void
+IdIndex::update() {
+  std::vector<Entry *> stale;
+  for(const auto& entry : sorted) {
+    if(entry->id != entry->password->id) stale.push_back(entry.get());
+  }
+  for(Entry *entry : stale) {
+    Password *password = entry->password;
+    erase(std::string(entry->id), password);
+    insert(password);
+  }
+}
+
+void
+IdIndex::clear() {
+  sorted.clear();
+  grams.clear();
+}
+
+void
+IdIndex::addGrams(Entry *entry) {
+  for(const std::uint32_t gram : trigrams(entry->id))
+    grams[gram].push_back(entry);
+}
+
+void
+IdIndex::removeGrams(Entry *entry) {
+  for(const std::uint32_t gram : trigrams(entry->id)) {
+    const auto it = grams.find(gram);
+    std::vector<Entry *>& posting = it->second;
+    *std::find(posting.begin(), posting.end(), entry) = posting.back();
+    posting.pop_back();
+    if(posting.empty()) grams.erase(it);
+  }
+}
+
+PasswordRange
+IdIndex::prefix(std::string_view prefix) const {
+  return PasswordRange(
+    [this, prefix = std::string(prefix), i = lowerBound(prefix)]() mutable
+      -> Password * {
+      if(i == sorted.size() || !sorted[i]->id.starts_with(prefix)) return NULL;
+      return sorted[i++]->password;
+    }
+  );
+}
+
+PasswordRange
+IdIndex::substring(std::string_view needle) const {
+  // too short for a trigram, so check every ID
+  if(needle.size() < 3) {
+    return PasswordRange(
+      [this, needle = std::string(needle), i = std::size_t(0)]() mutable
+        -> Password * {
+        while(i < sorted.size()) {
+          const Entry& entry = *sorted[i++];
+          if(entry.id.find(needle) != std::string::npos) return entry.password;
+        }
+        return NULL;
+      }
+    );
+  }
+
+  // check only the IDs with the needle's rarest trigram
+  const std::vector<Entry *> *posting = NULL;
+  for(const std::uint32_t gram : trigrams(needle)) {
+    const auto it = grams.find(gram);
+    if(it == grams.end())
+      return PasswordRange([]() -> Password * { return NULL; });
+    if(!posting || it->second.size() < posting->size()) posting = &it->second;
+  }
+  return PasswordRange(
+    [posting, needle = std::string(needle), i = std::size_t(0)]() mutable
+      -> Password * {
+      while(i < posting->size()) {
+        const Entry& entry = *(*posting)[i++];
+        if(entry.id.find(needle) != std::string::npos) return entry.password;
+      }
+      return NULL;
+    }
+  );
+}
+
+namespace {
+
+// Walks the sorted IDs like a trie, computing one row of the Levenshtein
+// table per character. Rows are shared by IDs with a common prefix, and a
+// prefix whose row is already over the limit is skipped as a whole. Only
+// the band of cells within maxEdits of the diagonal is computed; cells
+// outside it, and all values, are capped at maxEdits + 1.
+struct FuzzySearch {
+  FuzzySearch(std::string_view query, unsigned maxEdits)
+    : query(query), maxEdits(maxEdits), rows(query.size() + 1)
+  {
+    for(std::size_t j = 0; j <= query.size(); j++)
+      rows[j] = std::min<std::size_t>(j, maxEdits + 1);
+  }
+
+  template<typename Entries>
+  Password *next(const Entries& sorted) {
+    const std::size_t m = query.size();
+    const unsigned over = maxEdits + 1;
+    while(i < sorted.size()) {
+      const std::string& id = sorted[i]->id;
+
+      std::size_t depth = 0;
+      while(depth < path.size() && depth < id.size()
+          && path[depth] == id[depth])
+        depth++;
+      path.resize(depth);
+      rows.resize((depth + 1) * (m + 1));
+
+      bool pruned = false;
+      for(; depth < id.size(); depth++) {
+        rows.resize(rows.size() + m + 1);
+        const unsigned *prev = &rows[depth * (m + 1)];
+        unsigned *row = &rows[(depth + 1) * (m + 1)];
+
+        const std::size_t d = depth + 1;
+        const std::size_t lo = d > maxEdits ? d - maxEdits : 1;
+        const std::size_t hi = std::min(m, d + maxEdits);
+        row[0] = std::min<std::size_t>(d, over);
+        if(lo > 1 && lo - 1 <= m) row[lo - 1] = over;
+        if(hi < m) row[hi + 1] = over;
+
+        unsigned best = row[0];
+        for(std::size_t j = lo; j <= hi; j++) {
+          unsigned cell = prev[j - 1] + (id[depth] != query[j - 1]);
+          cell = std::min(cell, prev[j] + 1);
+          cell = std::min(cell, row[j - 1] + 1);
+          row[j] = std::min(cell, over);
+          best = std::min(best, row[j]);
+        }
+        path.push_back(id[depth]);
+        if(best > maxEdits) {
+          pruned = true;
+          break;
+        }
+      }
+
+      if(pruned) {
+        // nothing that starts with `path` can match
+        i = std::partition_point(sorted.begin() + i, sorted.end(),
+          [&](const auto& entry) { return entry->id.starts_with(path); })
+          - sorted.begin();
+        continue;
+      }
+
+      // the last cell is only computed if it lies in the band
+      Password *password = sorted[i++]->password;
+      const std::size_t lenDiff = id.size() > m ? id.size() - m : m - id.size();
+      if(lenDiff <= maxEdits && rows[id.size() * (m + 1) + m] <= maxEdits)
+        return password;
+    }
+    return NULL;
+  }
+
+  const std::string query;
+  const unsigned maxEdits;
+  std::size_t i = 0;
+  // the characters that the rows after the first are for
+  std::string path;
+  std::vector<unsigned> rows;
+};
+
+// Whether `a` and `b` are within `maxEdits` of each other, computing only
+// the band of the Levenshtein table around the diagonal.
+static bool
+withinEdits(std::string_view a, std::string_view b, unsigned maxEdits) {
+  const std::size_t m = b.size();
+  if((a.size() > m ? a.size() - m : m - a.size()) > maxEdits) return false;
+
+  const unsigned over = maxEdits + 1;
+  std::vector<unsigned> prev(m + 1), row(m + 1);
+  for(std::size_t j = 0; j <= m; j++)
+    prev[j] = std::min<std::size_t>(j, over);
+  for(std::size_t d = 1; d <= a.size(); d++) {
+    const std::size_t lo = d > maxEdits ? d - maxEdits : 1;
+    const std::size_t hi = std::min(m, d + maxEdits);
+    row[0] = std::min<std::size_t>(d, over);
+    if(lo > 1 && lo - 1 <= m) row[lo - 1] = over;
+    if(hi < m) row[hi + 1] = over;
+    unsigned best = row[0];
+    for(std::size_t j = lo; j <= hi; j++) {
+      unsigned cell = prev[j - 1] + (a[d - 1] != b[j - 1]);
+      cell = std::min(cell, prev[j] + 1);
+      cell = std::min(cell, row[j - 1] + 1);
+      row[j] = std::min(cell, over);
+      best = std::min(best, row[j]);
+    }
+    if(best > maxEdits) return false;
+    std::swap(prev, row);
+  }
+  return prev[m] <= maxEdits;
+}
+
+} // namespace
+
+PasswordRange
+IdIndex::fuzzy(std::string_view id, unsigned maxEdits) const {
+  // An edit changes at most three trigrams, so an ID within maxEdits shares
+  // all but 3 * maxEdits of the query's distinct trigrams. When that leaves
+  // some to require, only IDs with enough of them need to be checked.
+  std::vector<std::uint32_t> queryGrams = trigrams(id);
+  if(queryGrams.size() <= 3 * (std::size_t)maxEdits) {
+    auto search = std::make_shared<FuzzySearch>(id, maxEdits);
+    return PasswordRange([this, search]() { return search->next(sorted); });
+  }
+
+  const std::size_t required = queryGrams.size() - 3 * (std::size_t)maxEdits;
+  return PasswordRange(
+    [this, query = std::string(id), maxEdits, required,
+      queryGrams = std::move(queryGrams),
+      candidates = std::vector<const Entry *>(), i = std::size_t(0),
+      started = false]() mutable -> Password * {
+      if(!started) {
+        started = true;
+        std::vector<const Entry *> hits;
+        for(const std::uint32_t gram : queryGrams) {
+          const auto it = grams.find(gram);
+          if(it != grams.end())
+            hits.insert(hits.end(), it->second.begin(), it->second.end());
+        }
+        std::sort(hits.begin(), hits.end());
+        for(std::size_t j = 0; j < hits.size();) {
+          std::size_t k = j;
+          while(k < hits.size() && hits[k] == hits[j]) k++;
+          if(k - j >= required) candidates.push_back(hits[j]);
+          j = k;
+        }
+        std::sort(candidates.begin(), candidates.end(),
+          [](const Entry *a, const Entry *b) { return a->id < b->id; });
+      }
+
+      while(i < candidates.size()) {
+        const Entry& entry = *candidates[i++];
+        if(withinEdits(entry.id, query, maxEdits)) return entry.password;
+      }
+      return NULL;
+    }
+  );
+}
+
+} // namespace genpass::detail
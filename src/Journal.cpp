@@ -0,0 +1,229 @@
+/* ---------------------------------------------------------------------- *\
+ * src/Journal.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/Journal.hpp"
+
+#include <errno.h>            // for errno, EINTR
+#include <fcntl.h>            // for open, O_WRONLY, O_APPEND, O_CREAT
+#include <fmt/base.h>         // for println
+#include <fmt/format.h>       // for format
+#include <nlohmann/json.hpp>  // for basic_json
+#include <stdio.h>            // for stderr
+#include <unistd.h>           // for write, close, ftruncate, fdatasync
+#include <algorithm>          // for max
+#include <exception>          // for exception
+#include <fstream>            // for ifstream
+#include <iterator>           // for istreambuf_iterator
+#include <stdexcept>          // for runtime_error
+#include <system_error>       // for system_error, generic_category
+#include <utility>            // for move
+
+#include "genpass/detail/fmt_nlohmann.hpp"
+
+namespace genpass {
+
+static const std::size_t defaultCompactThreshold = 64 << 10;
+
+static std::system_error
+sysError(const char *what) {
+  return std::system_error(errno, std::generic_category(), what);
+}
+
+static std::size_t
+sizeOrZero(const std::filesystem::path& file) {
+  std::error_code ec;
+  const auto size = std::filesystem::file_size(file, ec);
+  return ec ? 0 : size;
+}
+
+Journal::Journal(Genpass& genpass, const std::filesystem::path& vault)
+  : genpass(genpass), vaultPath(vault), journalPath(pathFor(vault)),
+    format(VaultFormat::json), fd(-1), journalLen(0),
+    snapshotLen(sizeOrZero(vault)), compactThreshold(defaultCompactThreshold)
+{
+  if(std::filesystem::exists(vaultPath))
+    format = genpass.loadFrom(vaultPath);
+
+  fd = open(journalPath.c_str(),
+    O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+  if(fd < 0) throw sysError("failed to open journal");
+
+  try {
+    replay();
+  } catch(...) {
+    close(fd);
+    throw;
+  }
+  genpass.setListener(this);
+}
+
+Journal::~Journal() {
+  if(genpass.getListener() == this) genpass.setListener(NULL);
+  close(fd);
+}
+
+std::filesystem::path
+Journal::pathFor(const std::filesystem::path& vault) {
+  std::filesystem::path ret = vault;
+  ret += ".journal";
+  return ret;
+}
+
+void
+Journal::replay() {
+  std::ifstream in(journalPath, std::ios_base::binary);
+  const std::string text(std::istreambuf_iterator<char>(in), {});
+
+  std::size_t pos = 0;
+  while(pos < text.size()) {
+    const std::size_t end = text.find('\n', pos);
+    // a line without a newline was cut short by a crash while appending it
+    if(end == std::string::npos) {
+      fmt::println(stderr,
+        "warning: discarding incomplete record at the end of {}",
+        journalPath.native());
+      if(ftruncate(fd, pos)) throw sysError("failed to truncate journal");
+      break;
+    }
+
+    nlohmann::json record;
+    try {
+      record = nlohmann::json::parse(text.begin() + pos, text.begin() + end);
+      apply(record);
+    } catch(const std::exception& e) {
+      throw std::runtime_error(fmt::format("bad journal record at {}: {}",
+        pos, e.what()));
+    }
+    pos = end + 1;
+  }
+  journalLen = pos;
+}
+
+// Applies a record directly to the password map, so nothing is journaled.
+void
+Journal::apply(const nlohmann::json& record) {
+  const std::string op = record.at("op").get<std::string>();
+  if(op == "remove") {
+    genpass.erasePassword(record.at("id").get<std::string>());
+  } else if(op == "clear") {
+    genpass.destroyPasswords();
+  } else if(op == "put") {
+    put(record.at("password"));
+  } else if(op == "rename") {
+    // erase all old IDs first, since they may be new IDs of other entries
+    const nlohmann::json& renames = record.at("renames");
+    for(const nlohmann::json& rename : renames)
+      genpass.erasePassword(rename.at("from").get<std::string>());
+    for(const nlohmann::json& rename : renames)
+      put(rename.at("password"));
+  } else {
+    throw std::runtime_error(fmt::format("unknown journal op: {}", op));
+  }
+}
+
+void
+Journal::put(const nlohmann::json& pwJson) {
+  // build the new entry before erasing the old one, and fail the replay if
+  // it can't be built, since the next compaction would lose it for good
+  Password *password = genpass.buildPassword(pwJson);
+  if(!password) throw std::runtime_error(fmt::format(
+    "unknown algorithm for {}: {}", pwJson.at("id"),
+    pwJson.at("algorithm").get<std::string>()));
+  genpass.erasePassword(password->id);
+  genpass.insertPassword(password);
+}
+
+void
+Journal::append(const nlohmann::json& record) {
+  const std::string line = record.dump() + '\n';
+  std::size_t written = 0;
+  while(written < line.size()) {
+    const ssize_t n = write(fd, line.data() + written, line.size() - written);
+    if(n < 0) {
+      if(errno == EINTR) continue;
+      throw sysError("failed to append to journal");
+    }
+    written += n;
+  }
+  if(fdatasync(fd)) throw sysError("failed to sync journal");
+  journalLen += line.size();
+
+  // the change is already in the journal, so a failed compaction is only
+  // reported; the journal stays over the threshold, so the next append
+  // tries again
+  if(compactThreshold
+      && journalLen > std::max(compactThreshold, snapshotLen)) {
+    try {
+      compact();
+    } catch(const std::exception& e) {
+      fmt::println(stderr, "warning: failed to compact {}: {}",
+        journalPath.native(), e.what());
+    }
+  }
+}
+
+void
+Journal::compact() {
+  genpass.saveTo(vaultPath, format);
+  if(ftruncate(fd, 0)) throw sysError("failed to truncate journal");
+  if(fdatasync(fd)) throw sysError("failed to sync journal");
+  journalLen = 0;
+  snapshotLen = sizeOrZero(vaultPath);
+}
+
+void
+Journal::passwordPut(const Password& password) {
+  append({{"op", "put"}, {"password", password.serialize()}});
+}
+
+void
+Journal::passwordRemoved(const std::string& id) {
+  append({{"op", "remove"}, {"id", id}});
+}
+
+void
+Journal::passwordsRenamed(
+  const std::vector<std::pair<std::string, const Password *>>& renames
+) {
+  nlohmann::json renamesJson = nlohmann::json::array();
+  for(const auto& rename : renames)
+    renamesJson.push_back({{"from", rename.first},
+      {"password", rename.second->serialize()}});
+  append({{"op", "rename"}, {"renames", std::move(renamesJson)}});
+}
+
+void
+Journal::passwordsCleared() {
+  append({{"op", "clear"}});
+}
+
+void
+Journal::passwordsReindexed() {
+  // the old IDs aren't known, so the renames can't be journaled
+  compact();
+}
+
+void
+Journal::passwordsLoaded() {
+  // one snapshot instead of a synced record per loaded password
+  compact();
+}
+
+} // namespace genpass
@@ -0,0 +1,95 @@
+/* ---------------------------------------------------------------------- *\
+ * src/Metrics.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/Metrics.hpp"
+
+#include <nlohmann/json.hpp>  // for basic_json
+#include <atomic>             // for atomic, memory_order_acquire
+#include <utility>            // for pair
+
+#include "genpass/detail/instrument.hpp"  // for Probe
+
+namespace genpass {
+
+#ifdef GENPASS_INSTRUMENT
+
+// Probes are only ever added, at the head, so readers need no lock.
+static std::atomic<detail::Probe *> probes(NULL);
+
+detail::Probe::Probe(const char *name)
+  : name(name), calls(0), nanoseconds(0), bytes(0),
+    next(probes.load(std::memory_order_relaxed))
+{
+  // `next` is never changed once the probe is published
+  while(!probes.compare_exchange_weak(next, this,
+      std::memory_order_release, std::memory_order_relaxed));
+}
+
+Metrics
+metricsSnapshot() {
+  Metrics ret;
+  for(const detail::Probe *probe = probes.load(std::memory_order_acquire);
+      probe; probe = probe->next) {
+    const std::uint64_t calls = probe->calls.load(std::memory_order_relaxed);
+    if(!calls) continue;
+    ProbeStats& stats = ret.probes[probe->name];
+    stats.calls += calls;
+    stats.nanoseconds += probe->nanoseconds.load(std::memory_order_relaxed);
+    stats.bytes += probe->bytes.load(std::memory_order_relaxed);
+  }
+  return ret;
+}
+
+void
+resetMetrics() {
+  for(detail::Probe *probe = probes.load(std::memory_order_acquire);
+      probe; probe = probe->next) {
+    probe->calls.store(0, std::memory_order_relaxed);
+    probe->nanoseconds.store(0, std::memory_order_relaxed);
+    probe->bytes.store(0, std::memory_order_relaxed);
+  }
+}
+
+#else // GENPASS_INSTRUMENT
+
+Metrics
+metricsSnapshot() {
+  return Metrics();
+}
+
+void
+resetMetrics() { }
+
+#endif // GENPASS_INSTRUMENT
+
+nlohmann::json
+Metrics::toJson() const {
+  nlohmann::json ret = nlohmann::json::object();
+  for(const auto& [name, stats] : probes) {
+    ret[name] = {
+      {"calls", stats.calls},
+      {"nanoseconds", stats.nanoseconds},
+      {"bytes", stats.bytes},
+    };
+  }
+  return ret;
+}
+
+} // namespace genpass
@@ -24,13 +24,17 @@
 #include <nlohmann/json.hpp>             // for basic_json
 #include <openssl/evp.h>                 // for EVP_EncodeBlock, EVP_MAC_CTX...
 #include <openssl/types.h>               // for EVP_MAC, EVP_MAC_CTX
-#include <cstring>                       // for memcpy
+#include <openssl/crypto.h>              // for OPENSSL_cleanse
+#include <algorithm>                     // for copy
 #include <map>                           // for operator==
+#include <memory>                        // for make_unique, unique_ptr
 #include <stdexcept>                     // for runtime_error, invalid_argument
 #include <functional>
+#include <typeinfo>                      // for type_info
 
 #include "genpass/Seed.hpp"                      // for Seed
-#include "genpass/detail/ossl_ptr.hpp"             // for ossl_unique_ptr
+#include "genpass/detail/HmacSha256.hpp"           // for HmacSha256
+#include "genpass/detail/instrument.hpp"           // for GENPASS_TIME
 #include "genpass/detail/serialize.hpp"            // for serialize
 #include "genpass/Genpass.hpp"
 
@@ -46,6 +50,26 @@ Password::Password(const std::string& id)
 
 Password::~Password() = default;
 
+std::string
+Password::generate(const Seed& seed, EVP_MAC_CTX *) const {
+  return generate(seed);
+}
+
+SecureString
+Password::generateSecure(const Seed& seed) const {
+  // the built-in HMAC needs no context
+  if(seed.getHmacEngine()) return generateSecure(seed, NULL);
+  return generateSecure(seed, seed.newMac().get());
+}
+
+SecureString
+Password::generateSecure(const Seed& seed, EVP_MAC_CTX *mac) const {
+  std::string pw = generate(seed, mac);
+  SecureString ret(pw);
+  OPENSSL_cleanse(pw.data(), pw.size());
+  return ret;
+}
+
 nlohmann::json
 Password::serialize() const {
   return nlohmann::json{
@@ -79,91 +103,164 @@ from_json(const nlohmann::json& json, Password& password) {
 PasswordV2::PasswordV2() : PasswordV2("") { }
 
 PasswordV2::PasswordV2(const std::string& id)
-  : Password(id), length(48), postfix("aA1!"), fill('0')
+  : Password(id), policy(Policy::defaults())
+{ }
+
+PasswordV2::PasswordV2(const PasswordV2& other)
+  : Password(other), policy(other.policy), plan(other.plan.load())
 { }
 
 PasswordV2::~PasswordV2() = default;
 
+PasswordV2&
+PasswordV2::operator=(const PasswordV2& other) {
+  Password::operator=(other);
+  policy = other.policy;
+  plan = other.plan.load();
+  return *this;
+}
+
+std::unique_ptr<Password>
+PasswordV2::clone() const {
+  return std::make_unique<PasswordV2>(*this);
+}
+
 void
 PasswordV2::registerWith(Genpass& genpass) {
-  genpass.registerAlgorithm(algName, [](){ return new PasswordV2(); });
+  genpass.registerAlgorithm<PasswordV2>(algName);
 }
 
 std::string
 PasswordV2::generate(const Seed& seed) const {
+  // the built-in HMAC needs no context
+  if(seed.getHmacEngine()) return generate(seed, NULL);
+  return generate(seed, seed.newMac().get());
+}
 
-  const std::size_t genDataSize = sizeof(std::int32_t) + id.length();
-  unsigned char genData[genDataSize];
-  unsigned char *p = genData;
-
-  p += genpass::serialize(p, (std::int32_t)serial);
-  static_assert(sizeof(*id.data()) == 1);
-  std::memcpy(p, id.data(), id.length());
+std::string
+PasswordV2::generate(const Seed& seed, EVP_MAC_CTX *mac) const {
+  std::string pw(policy->getLength(), '\0');
+  generateInto(seed, mac, pw);
+  return pw;
+}
 
-  ossl_unique_ptr<EVP_MAC> macAlg(
-    EVP_MAC_fetch(NULL, "HMAC", "digest='SHA256'"),
-    &EVP_MAC_free
-  );
-  if(!macAlg)
-    throw std::runtime_error("failed to fetch MAC algorithm");
+SecureString
+PasswordV2::generateSecure(const Seed& seed, EVP_MAC_CTX *mac) const {
+  // a subclass that overrides generate must be copied from it
+  if(typeid(*this) != typeid(PasswordV2))
+    return Password::generateSecure(seed, mac);
+  SecureString pw(policy->getLength());
+  generateInto(seed, mac, pw.span());
+  return pw;
+}
 
-  ossl_unique_ptr<EVP_MAC_CTX> mac(EVP_MAC_CTX_new(macAlg.get()),
-    &EVP_MAC_CTX_free);
-  if(!mac)
-    throw std::runtime_error("failed to create MAC context");
+std::size_t
+PasswordV2::generateInto(const Seed& seed, std::span<char> out) const {
+  if(seed.getHmacEngine()) return generateInto(seed, NULL, out);
+  return generateInto(seed, seed.newMac().get(), out);
+}
 
-  if(!EVP_MAC_init_SKEY(mac.get(), seed.getKey(), NULL))
-    throw std::runtime_error("failure in MAC initialization");
+std::size_t
+PasswordV2::generateInto(
+  const Seed& seed,
+  EVP_MAC_CTX *mac,
+  std::span<char> out
+) const {
+  GENPASS_TIME("passwordV2.generate", out.size());
+  const std::shared_ptr<const Plan> plan = getPlan();
+  const unsigned char *message = (const unsigned char *)plan->message.data();
+
+  unsigned char macOut[EVP_MAX_MD_SIZE];
+  std::size_t macOutLen;
+  if(const detail::HmacSha256 *engine = seed.getHmacEngine()) {
+    engine->mac(message, plan->message.length(), macOut);
+    macOutLen = detail::HmacSha256::macSize;
+  } else {
+    // reset to the pre-keyed state; this does not redo the key schedule
+    if(!EVP_MAC_init(mac, NULL, 0, NULL))
+      throw std::runtime_error("failure in MAC initialization");
+    if(!EVP_MAC_update(mac, message, plan->message.length()))
+      throw std::runtime_error("failure in MAC update");
+    if(!EVP_MAC_final(mac, macOut, &macOutLen, sizeof(macOut)))
+      throw std::runtime_error("failed to finalize MAC");
+  }
 
-  if(!EVP_MAC_update(mac.get(), genData, genDataSize))
-    throw std::runtime_error("failure in MAC update");
+  const std::size_t ret = fromMacInto(macOut, macOutLen, out);
+  OPENSSL_cleanse(macOut, sizeof(macOut));
+  return ret;
+}
 
-  std::size_t macSize = EVP_MAC_CTX_get_mac_size(mac.get());
-  if(!macSize)
-    throw std::runtime_error("failed to query MAC size");
+std::shared_ptr<const std::string>
+PasswordV2::macMessage() const {
+  std::shared_ptr<const Plan> plan = getPlan();
+  const std::string *message = &plan->message;
+  return std::shared_ptr<const std::string>(std::move(plan), message);
+}
 
-  unsigned char macOut[macSize];
-  std::size_t macOutLen;
-  if(!EVP_MAC_final(mac.get(), macOut, &macOutLen, macSize))
-    throw std::runtime_error("failed to finalize MAC");
+std::shared_ptr<const PasswordV2::Plan>
+PasswordV2::getPlan() const {
+  static_assert(sizeof(*id.data()) == 1);
+  constexpr std::size_t serialLen = sizeof(std::int32_t);
+
+  std::shared_ptr<const Plan> current = plan.load(std::memory_order_acquire);
+  if(current && current->serial == serial
+      && std::string_view(current->message).substr(serialLen) == id)
+    return current;
+
+  GENPASS_COUNT("alloc.plan", serialLen + id.length());
+  auto fresh = std::make_shared<Plan>();
+  fresh->serial = serial;
+  fresh->message.resize(serialLen + id.length());
+  genpass::serialize((unsigned char *)fresh->message.data(),
+    (std::int32_t)serial);
+  std::copy(id.begin(), id.end(), fresh->message.begin() + serialLen);
+
+  current = std::move(fresh);
+  plan.store(current, std::memory_order_release);
+  return current;
+}
 
-  unsigned char encoded[(macOutLen / 3 + 1) * 4];
-  EVP_EncodeBlock(encoded, macOut, macOutLen);
+std::string
+PasswordV2::fromMac(const unsigned char *mac, std::size_t macLen) const {
+  std::string pw(policy->getLength(), '\0');
+  fromMacInto(mac, macLen, pw);
+  return pw;
+}
 
-  return prepare((char *)encoded);
+std::size_t
+PasswordV2::fromMacInto(
+  const unsigned char *mac,
+  std::size_t macLen,
+  std::span<char> out
+) const {
+  return policy->fromMacInto(mac, macLen, out);
 }
 
 std::string
 PasswordV2::prepare(const std::string& base) const {
-  std::string pw(base);
-
-  // remove banned chars
-  for(std::size_t i = 0; i < pw.length(); i++) {
-    if(bannedChars.find(pw[i]) != bannedChars.end()) {
-      pw.erase(i--, 1);
-    }
-  }
-
-  // truncate or pad to the preferred length
-  if(length < postfix.length())
-    throw std::invalid_argument("postfix too long");
-  pw.resize(length - postfix.length(), fill);
-
-  // append postfix
-  pw += postfix;
+  std::string pw(policy->getLength(), '\0');
+  prepareInto(base, pw);
+  return pw;
+}
 
+SecureString
+PasswordV2::prepareSecure(std::string_view base) const {
+  SecureString pw(policy->getLength());
+  prepareInto(base, pw.span());
   return pw;
 }
 
+std::size_t
+PasswordV2::prepareInto(std::string_view base, std::span<char> out) const {
+  GENPASS_TIME("passwordV2.prepare", base.size());
+  return policy->prepareInto(base, out);
+}
+
 nlohmann::json
 PasswordV2::serialize() const {
   nlohmann::json json = Password::serialize();
-  json.update(nlohmann::json{
-    {"length", length},
-    {"postfix", postfix},
-    {"bannedChars", bannedChars},
-    {"fill", fill}
-  });
+  policy->serialize(json);
+  if(!policy->getName().empty()) json["policy"] = policy->getName();
   return json;
 }
 
@@ -171,10 +268,10 @@ void
 PasswordV2::deserialize(const nlohmann::json& json) {
   Password::deserialize(json);
 
-  json.at("length").get_to(length);
-  json.at("postfix").get_to(postfix);
-  json.at("bannedChars").get_to(bannedChars);
-  json.at("fill").get_to(fill);
+  const auto name = json.find("policy");
+  policy = Policy::intern(
+    name != json.end() ? name->get<std::string>() : std::string(),
+    Policy::deserializeRules(json));
 }
 
 } // namespace genpass
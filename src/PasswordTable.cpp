@@ -0,0 +1,143 @@
+/* ---------------------------------------------------------------------- *\
+ * src/PasswordTable.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/detail/PasswordTable.hpp"
+
+#include <algorithm>   // for max
+#include <cassert>     // for assert
+#include <functional>  // for hash
+
+#include "genpass/Password.hpp"  // for Password
+
+namespace genpass::detail {
+
+static const std::size_t minCapacity = 16;
+
+// Linear probing stays short as long as the table is at most 7/8 full.
+static bool
+fits(std::size_t count, std::size_t capacity) {
+  return count <= capacity - capacity / 8;
+}
+
+std::size_t
+PasswordTable::hashId(std::string_view id) {
+  return std::hash<std::string_view>()(id);
+}
+
+Password *
+PasswordTable::find(std::string_view id) const {
+  if(!count) return NULL;
+  const std::size_t hash = hashId(id);
+  for(std::size_t i = hash & mask(); slots[i].password; i = (i + 1) & mask()) {
+    if(slots[i].hash == hash && slots[i].password->id == id)
+      return slots[i].password;
+  }
+  return NULL;
+}
+
+Password *
+PasswordTable::findStale(std::string_view oldId) const {
+  if(!count) return NULL;
+  const std::size_t hash = hashId(oldId);
+  Password *stale = NULL;
+  for(std::size_t i = hash & mask(); slots[i].password; i = (i + 1) & mask()) {
+    if(slots[i].hash != hash) continue;
+    if(slots[i].password->id == oldId) return slots[i].password;
+    if(!stale && hashId(slots[i].password->id) != hash)
+      stale = slots[i].password;
+  }
+  return stale;
+}
+
+bool
+PasswordTable::insert(Password *password, std::size_t hash) {
+  if(!fits(count + 1, slots.size())) reserve(count + 1);
+
+  std::size_t i = hash & mask();
+  for(; slots[i].password; i = (i + 1) & mask()) {
+    if(slots[i].hash == hash && slots[i].password->id == password->id)
+      return false;
+  }
+  slots[i] = {hash, password};
+  count++;
+  return true;
+}
+
+bool
+PasswordTable::insert(Password *password) {
+  return insert(password, hashId(password->id));
+}
+
+// Uses backward-shift deletion, so that no tombstones are left behind.
+void
+PasswordTable::erase(const Password *password, std::size_t hash) {
+  std::size_t i = hash & mask();
+  while(slots[i].password != password) {
+    assert(slots[i].password);
+    i = (i + 1) & mask();
+  }
+
+  for(std::size_t j = (i + 1) & mask(); slots[j].password;
+      j = (j + 1) & mask()) {
+    // move slot j into the hole at i unless its home lies in (i, j]
+    const std::size_t home = slots[j].hash & mask();
+    if(((j - home) & mask()) >= ((j - i) & mask())) {
+      slots[i] = slots[j];
+      i = j;
+    }
+  }
+  slots[i] = {0, NULL};
+  count--;
+}
+
+std::vector<std::pair<Password *, std::size_t>>
+PasswordTable::extractStale() {
+  std::vector<std::pair<Password *, std::size_t>> ret;
+  for(const Slot& slot : slots) {
+    if(slot.password && hashId(slot.password->id) != slot.hash)
+      ret.emplace_back(slot.password, slot.hash);
+  }
+  for(const auto& entry : ret) erase(entry.first, entry.second);
+  return ret;
+}
+
+void
+PasswordTable::clear() {
+  slots.clear();
+  count = 0;
+}
+
+void
+PasswordTable::reserve(std::size_t n) {
+  std::size_t capacity = std::max(slots.size(), minCapacity);
+  while(!fits(n, capacity)) capacity *= 2;
+  if(capacity == slots.size()) return;
+
+  std::vector<Slot> old(capacity, Slot{0, NULL});
+  old.swap(slots);
+  for(const Slot& slot : old) {
+    if(!slot.password) continue;
+    std::size_t i = slot.hash & mask();
+    while(slots[i].password) i = (i + 1) & mask();
+    slots[i] = slot;
+  }
+}
+
+} // namespace genpass::detail
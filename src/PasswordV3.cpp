@@ -0,0 +1,245 @@
+/* ---------------------------------------------------------------------- *\
+ * src/PasswordV3.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/Password.hpp"
+
+#include <nlohmann/json.hpp>  // for basic_json
+#include <openssl/crypto.h>   // for OPENSSL_cleanse
+#include <openssl/evp.h>      // for EVP_MAC_init, EVP_MAC_update, EVP_MA...
+#include <cstdint>            // for uint32_t, uint64_t
+#include <stdexcept>          // for invalid_argument, runtime_error
+#include <string_view>        // for string_view
+#include <typeinfo>           // for type_info
+#include <utility>            // for swap
+
+#include "genpass/Genpass.hpp"            // for Genpass
+#include "genpass/Seed.hpp"               // for Seed
+#include "genpass/detail/HmacSha256.hpp"  // for HmacSha256
+#include "genpass/detail/instrument.hpp"  // for GENPASS_TIME
+#include "genpass/detail/serialize.hpp"   // for serialize
+
+namespace genpass {
+
+namespace {
+
+// HMAC-SHA256 in counter mode with the seed as the key, read as it is
+// needed. This is the counter mode KDF of NIST SP 800-108, without the
+// separator and output length fields, since the length is not known up
+// front.
+class Keystream {
+public:
+  Keystream(const Seed& seed, EVP_MAC_CTX *mac, std::string_view info)
+    : engine(seed.getHmacEngine()), mac(mac), input(4, '\0'), counter(0),
+      pos(sizeof(block))
+  {
+    input += info;
+  }
+  Keystream(const Keystream&) = delete;
+  ~Keystream() {
+    OPENSSL_cleanse(block, sizeof(block));
+  }
+
+  unsigned char byte() {
+    if(pos == sizeof(block)) nextBlock();
+    return block[pos++];
+  }
+
+  // Returns a uniform value in [0, n), for 0 < n <= 2^32.
+  std::uint32_t below(std::uint64_t n) {
+    if(n <= 256) {
+      // reject the top values that would favour the low results
+      const unsigned limit = 256 - 256 % n;
+      for(;;) {
+        const unsigned b = byte();
+        if(b < limit) return b % n;
+      }
+    }
+    const std::uint64_t limit = (std::uint64_t(1) << 32)
+      - (std::uint64_t(1) << 32) % n;
+    for(;;) {
+      std::uint64_t v = 0;
+      for(int i = 0; i < 4; i++) v |= std::uint64_t(byte()) << (8 * i);
+      if(v < limit) return v % n;
+    }
+  }
+
+private:
+  // K(i) = HMAC(key, [i]_32 || info), with i big-endian from 1
+  void nextBlock() {
+    if(++counter == 0)
+      throw std::runtime_error("password needs too much keystream");
+    for(int i = 0; i < 4; i++) input[i] = (char)(counter >> (24 - 8 * i));
+
+    const unsigned char *msg = (const unsigned char *)input.data();
+    if(engine) {
+      engine->mac(msg, input.length(), block);
+    } else {
+      std::size_t len;
+      if(!EVP_MAC_init(mac, NULL, 0, NULL))
+        throw std::runtime_error("failure in MAC initialization");
+      if(!EVP_MAC_update(mac, msg, input.length()))
+        throw std::runtime_error("failure in MAC update");
+      if(!EVP_MAC_final(mac, block, &len, sizeof(block)) || len != sizeof(block))
+        throw std::runtime_error("failed to finalize MAC");
+    }
+    pos = 0;
+  }
+
+  const detail::HmacSha256 *engine;
+  EVP_MAC_CTX *mac;
+  // the counter, followed by the info
+  std::string input;
+  std::uint32_t counter;
+  unsigned char block[detail::HmacSha256::macSize];
+  std::size_t pos;
+};
+
+} // namespace
+
+PasswordV3::PasswordV3() : PasswordV3("") { }
+
+PasswordV3::PasswordV3(const std::string& id)
+  : Password(id), length(24), alphabet(CharClass::ascii),
+    requirements{
+      {CharClass::lowercase, 1},
+      {CharClass::uppercase, 1},
+      {CharClass::digit, 1},
+      {CharClass::special, 1}
+    }
+{ }
+
+PasswordV3::~PasswordV3() = default;
+
+std::unique_ptr<Password>
+PasswordV3::clone() const {
+  return std::make_unique<PasswordV3>(*this);
+}
+
+void
+PasswordV3::registerWith(Genpass& genpass) {
+  genpass.registerAlgorithm<PasswordV3>(algName);
+}
+
+std::string
+PasswordV3::generate(const Seed& seed) const {
+  // the built-in HMAC needs no context
+  if(seed.getHmacEngine()) return generate(seed, NULL);
+  return generate(seed, seed.newMac().get());
+}
+
+std::string
+PasswordV3::generate(const Seed& seed, EVP_MAC_CTX *mac) const {
+  checkRules();
+  std::string pw(length, '\0');
+  generateInto(seed, mac, pw);
+  return pw;
+}
+
+SecureString
+PasswordV3::generateSecure(const Seed& seed, EVP_MAC_CTX *mac) const {
+  // a subclass that overrides generate must be copied from it
+  if(typeid(*this) != typeid(PasswordV3))
+    return Password::generateSecure(seed, mac);
+  checkRules();
+  SecureString pw(length);
+  generateInto(seed, mac, pw.span());
+  return pw;
+}
+
+void
+PasswordV3::generateInto(
+  const Seed& seed,
+  EVP_MAC_CTX *mac,
+  std::span<char> out
+) const {
+  GENPASS_TIME("passwordV3.generate", length);
+
+  std::string info = algName;
+  unsigned char serialData[sizeof(std::int32_t)];
+  genpass::serialize(serialData, (std::int32_t)serial);
+  info.append((const char *)serialData, sizeof(serialData));
+  info += id;
+  Keystream keystream(seed, mac, info);
+
+  std::size_t n = 0;
+  for(const Requirement& requirement : requirements) {
+    if(!requirement.min) continue;
+    const CharClass required = requirement.chars & alphabet;
+    for(std::size_t i = 0; i < requirement.min; i++)
+      out[n++] = required[keystream.below(required.size())];
+  }
+  while(n < length)
+    out[n++] = alphabet[keystream.below(alphabet.size())];
+
+  // so that the required chars can be anywhere
+  for(std::size_t i = length; i > 1; i--)
+    std::swap(out[i - 1], out[keystream.below(i)]);
+}
+
+void
+PasswordV3::checkRules() const {
+  if(alphabet.empty()) throw std::invalid_argument("empty alphabet");
+  std::size_t required = 0;
+  for(const Requirement& requirement : requirements) {
+    if(requirement.min && (requirement.chars & alphabet).empty())
+      throw std::invalid_argument("requirement has no chars in the alphabet");
+    required += requirement.min;
+  }
+  if(required > length)
+    throw std::invalid_argument("requirements exceed the length");
+}
+
+nlohmann::json
+PasswordV3::serialize() const {
+  nlohmann::json json = Password::serialize();
+  json["length"] = length;
+  const std::string chars = alphabet.str();
+  json["alphabet"] = std::vector<char>(chars.begin(), chars.end());
+  nlohmann::json& requirementsJson = json["requirements"] =
+    nlohmann::json::array();
+  for(const Requirement& requirement : requirements) {
+    const std::string required = requirement.chars.str();
+    requirementsJson.push_back({
+      {"chars", std::vector<char>(required.begin(), required.end())},
+      {"min", requirement.min}
+    });
+  }
+  return json;
+}
+
+void
+PasswordV3::deserialize(const nlohmann::json& json) {
+  Password::deserialize(json);
+
+  json.at("length").get_to(length);
+  const auto chars = json.at("alphabet").get<std::vector<char>>();
+  alphabet = CharClass(std::string(chars.begin(), chars.end()));
+  requirements.clear();
+  for(const auto& requirementJson : json.at("requirements")) {
+    const auto required =
+      requirementJson.at("chars").get<std::vector<char>>();
+    requirements.push_back({
+      CharClass(std::string(required.begin(), required.end())),
+      requirementJson.at("min").get<std::size_t>()
+    });
+  }
+}
+
+} // namespace genpass
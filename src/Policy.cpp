@@ -0,0 +1,158 @@
+/* ---------------------------------------------------------------------- *\
+ * src/Policy.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/Policy.hpp"
+
+#include <nlohmann/json.hpp>  // for basic_json
+#include <algorithm>          // for copy, fill, sort
+#include <mutex>              // for mutex, lock_guard
+#include <stdexcept>          // for invalid_argument
+#include <string>             // for string, to_string
+#include <string_view>        // for string_view
+#include <unordered_map>      // for unordered_map
+
+#include "genpass/detail/base64.hpp"  // for base64Filtered
+
+namespace genpass {
+
+// Appends `field` to `key` after its length, so that no two lists of fields
+// give the same key, whatever chars they hold.
+static void
+appendField(std::string& key, std::string_view field) {
+  key += std::to_string(field.size());
+  key += ':';
+  key += field;
+}
+
+// Identifies a name and rules in the intern pool.
+static std::string
+internKey(const std::string& name, const PolicyRules& rules) {
+  std::string banned(rules.bannedChars.begin(), rules.bannedChars.end());
+  std::sort(banned.begin(), banned.end());
+
+  std::string key;
+  appendField(key, name);
+  appendField(key, std::to_string(rules.length));
+  appendField(key, std::string_view(&rules.fill, 1));
+  appendField(key, banned);
+  appendField(key, rules.postfix);
+  return key;
+}
+
+std::shared_ptr<const Policy>
+Policy::intern(const std::string& name, const PolicyRules& rules) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::weak_ptr<const Policy>> pool;
+
+  if(!name.empty() && name[0] == '#')
+    throw std::invalid_argument("policy name may not start with #");
+
+  const std::string key = internKey(name, rules);
+  const std::lock_guard<std::mutex> lock(mutex);
+
+  std::weak_ptr<const Policy>& slot = pool[key];
+  if(std::shared_ptr<const Policy> existing = slot.lock()) return existing;
+
+  auto policy = std::make_shared<const Policy>(Private(), name, rules);
+  slot = policy;
+
+  // forget dead policies now and then, so that the pool stays in proportion
+  // to the policies in use
+  static std::size_t pruneAt = 64;
+  if(pool.size() >= pruneAt) {
+    std::erase_if(pool, [](const auto& entry) { return entry.second.expired(); });
+    pruneAt = std::max<std::size_t>(64, pool.size() * 2);
+  }
+  return policy;
+}
+
+const std::shared_ptr<const Policy>&
+Policy::defaults() {
+  static const std::shared_ptr<const Policy> policy = intern(PolicyRules());
+  return policy;
+}
+
+Policy::Policy(Private, const std::string& name, const PolicyRules& rules)
+  : name(name), rules(rules),
+    banned(std::string(rules.bannedChars.begin(), rules.bannedChars.end())),
+    bodyLength(rules.length - rules.postfix.length())
+{
+  if(rules.length < rules.postfix.length())
+    throw std::invalid_argument("postfix too long");
+}
+
+void
+Policy::serialize(nlohmann::json& json) const {
+  json["length"] = rules.length;
+  json["postfix"] = rules.postfix;
+  json["bannedChars"] = rules.bannedChars;
+  json["fill"] = rules.fill;
+}
+
+PolicyRules
+Policy::deserializeRules(const nlohmann::json& json) {
+  PolicyRules rules;
+  json.at("length").get_to(rules.length);
+  json.at("postfix").get_to(rules.postfix);
+  json.at("bannedChars").get_to(rules.bannedChars);
+  json.at("fill").get_to(rules.fill);
+  return rules;
+}
+
+std::size_t
+Policy::prepareInto(std::string_view base, std::span<char> out) const {
+  if(out.size() < rules.length)
+    throw std::invalid_argument("output buffer too small");
+
+  // remove banned chars
+  const std::size_t n = banned.copyWithout(base, out.data(), bodyLength);
+
+  return finishLayout(n, out);
+}
+
+std::size_t
+Policy::fromMacInto(
+  const unsigned char *mac,
+  std::size_t macLen,
+  std::span<char> out
+) const {
+  if(out.size() < rules.length)
+    throw std::invalid_argument("output buffer too small");
+
+  // encode and drop banned chars straight into the output
+  const std::size_t n =
+    detail::base64Filtered(mac, macLen, banned, out.data(), bodyLength);
+
+  return finishLayout(n, out);
+}
+
+std::size_t
+Policy::finishLayout(std::size_t n, std::span<char> out) const {
+  // pad to the preferred length
+  std::fill(out.begin() + n, out.begin() + bodyLength, rules.fill);
+
+  // append postfix
+  std::copy(rules.postfix.begin(), rules.postfix.end(),
+    out.begin() + bodyLength);
+
+  return rules.length;
+}
+
+} // namespace genpass
@@ -0,0 +1,149 @@
+/* ---------------------------------------------------------------------- *\
+ * src/ReverseIndex.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/ReverseIndex.hpp"
+
+#include <openssl/crypto.h>  // for CRYPTO_memcmp, OPENSSL_cleanse
+#include <openssl/rand.h>    // for RAND_bytes
+#include <algorithm>         // for min
+#include <cstdint>           // for int64_t, uint64_t
+#include <cstring>           // for memcpy
+#include <stdexcept>         // for runtime_error, length_error
+#include <utility>           // for move
+
+#include "genpass/SecureString.hpp"       // for SecureString
+#include "genpass/detail/HmacSha256.hpp"  // for HmacSha256
+#include "genpass/detail/parallel.hpp"    // for parallelFor
+
+namespace genpass {
+
+// the slots for this many take up 12 GiB
+static const std::size_t maxPairs = std::size_t(1) << 28;
+
+ReverseIndex::ReverseIndex(
+  std::vector<std::string>&& ids,
+  std::int32_t firstSerial,
+  std::int32_t lastSerial
+) : ids(std::move(ids)), firstSerial(firstSerial), lastSerial(lastSerial),
+    count(0)
+{
+  // checked before multiplying, so that it can't overflow
+  const std::uint64_t serials = (std::int64_t)lastSerial - firstSerial + 1;
+  if(serials > maxPairs || this->ids.size() > maxPairs / serials)
+    throw std::length_error("reverse index window is too large");
+  const std::size_t pairs = this->ids.size() * serials;
+
+  unsigned char key[detail::HmacSha256::macSize];
+  if(RAND_bytes(key, sizeof(key)) != 1)
+    throw std::runtime_error("failed to generate index key");
+  hmac = std::make_unique<detail::HmacSha256>(key, sizeof(key));
+  OPENSSL_cleanse(key, sizeof(key));
+
+  std::size_t capacity = 16;
+  while(capacity < pairs * 2) capacity *= 2;
+  slots.assign(capacity, Slot{{}, noOwner, 0});
+}
+
+ReverseIndex::ReverseIndex(ReverseIndex&&) = default;
+ReverseIndex& ReverseIndex::operator=(ReverseIndex&&) = default;
+ReverseIndex::~ReverseIndex() = default;
+
+void
+ReverseIndex::tagOf(std::string_view password, unsigned char *tag) const {
+  unsigned char mac[detail::HmacSha256::macSize];
+  hmac->mac((const unsigned char *)password.data(), password.size(), mac);
+  std::memcpy(tag, mac, tagLen);
+  OPENSSL_cleanse(mac, sizeof(mac));
+}
+
+std::size_t
+ReverseIndex::slotOf(const unsigned char *tag) {
+  // the tag is already uniformly distributed
+  std::size_t ret;
+  std::memcpy(&ret, tag, sizeof(ret));
+  return ret;
+}
+
+void
+ReverseIndex::add(
+  const std::vector<SecureString>& generated,
+  std::int32_t serial,
+  unsigned threads
+) {
+  constexpr std::size_t lanes = detail::HmacSha256::lanes;
+  constexpr std::size_t macSize = detail::HmacSha256::macSize;
+
+  std::vector<unsigned char> tags(generated.size() * tagLen);
+  detail::parallelFor(generated.size(), threads,
+    [&](std::size_t begin, std::size_t end, unsigned) {
+      unsigned char macBuf[lanes][macSize];
+      for(std::size_t i = begin; i < end; i += lanes) {
+        const std::size_t n = std::min(lanes, end - i);
+        const unsigned char *msgs[lanes];
+        std::size_t lens[lanes];
+        unsigned char *macs[lanes];
+        for(std::size_t lane = 0; lane < n; lane++) {
+          msgs[lane] = (const unsigned char *)generated[i + lane].data();
+          lens[lane] = generated[i + lane].size();
+          macs[lane] = macBuf[lane];
+        }
+        hmac->macMulti(n, msgs, lens, macs);
+        for(std::size_t lane = 0; lane < n; lane++)
+          std::memcpy(&tags[(i + lane) * tagLen], macBuf[lane], tagLen);
+      }
+      OPENSSL_cleanse(macBuf, sizeof(macBuf));
+    }
+  );
+
+  for(std::size_t i = 0; i < generated.size(); i++)
+    insert(&tags[i * tagLen], (std::uint32_t)i, serial);
+}
+
+void
+ReverseIndex::insert(
+  const unsigned char *tag,
+  std::uint32_t owner,
+  std::int32_t serial
+) {
+  std::size_t i = slotOf(tag) & mask();
+  while(slots[i].owner != noOwner) i = (i + 1) & mask();
+  std::memcpy(slots[i].tag, tag, tagLen);
+  slots[i].owner = owner;
+  slots[i].serial = serial;
+  count++;
+}
+
+std::vector<ReverseIndex::Match>
+ReverseIndex::find(std::string_view password) const {
+  unsigned char tag[tagLen];
+  tagOf(password, tag);
+
+  // equal passwords have equal tags, so all of them are in this run
+  std::vector<Match> ret;
+  for(std::size_t i = slotOf(tag) & mask(); slots[i].owner != noOwner;
+      i = (i + 1) & mask()) {
+    if(!CRYPTO_memcmp(slots[i].tag, tag, tagLen))
+      ret.push_back({ids[slots[i].owner], slots[i].serial});
+  }
+  OPENSSL_cleanse(tag, sizeof(tag));
+  return ret;
+}
+
+} // namespace genpass
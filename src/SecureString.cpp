@@ -0,0 +1,74 @@
+/* ---------------------------------------------------------------------- *\
+ * src/SecureString.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/SecureString.hpp"
+
+#include <openssl/crypto.h>  // for CRYPTO_memcmp
+#include <cstring>           // for memcpy
+#include <utility>           // for exchange
+
+#include "genpass/detail/secureAlloc.hpp"  // for secureAllocate, secureRel...
+
+namespace genpass {
+
+SecureString::SecureString(std::size_t size)
+  : buf(size ? (char *)detail::secureAllocate(size + 1) : NULL), len(size)
+{ }
+
+SecureString::SecureString(std::string_view str)
+  : SecureString(str.size())
+{
+  if(len) std::memcpy(buf, str.data(), len);
+}
+
+SecureString::SecureString(const SecureString& other)
+  : SecureString(other.view())
+{ }
+
+SecureString::SecureString(SecureString&& other) noexcept
+  : buf(std::exchange(other.buf, nullptr)), len(std::exchange(other.len, 0))
+{ }
+
+SecureString::~SecureString() {
+  if(buf) detail::secureRelease(buf, len + 1);
+}
+
+SecureString&
+SecureString::operator=(const SecureString& other) {
+  if(this != &other) *this = SecureString(other);
+  return *this;
+}
+
+SecureString&
+SecureString::operator=(SecureString&& other) noexcept {
+  if(this != &other) {
+    if(buf) detail::secureRelease(buf, len + 1);
+    buf = std::exchange(other.buf, nullptr);
+    len = std::exchange(other.len, 0);
+  }
+  return *this;
+}
+
+bool
+operator==(const SecureString& a, const SecureString& b) {
+  return a.len == b.len && !CRYPTO_memcmp(a.data(), b.data(), a.len);
+}
+
+} // namespace genpass
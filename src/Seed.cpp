@@ -20,17 +20,36 @@
 
 #include "genpass/Seed.hpp"
 
+#include <fmt/base.h>            // for println
+#include <fmt/format.h>          // for format
 #include <openssl/core.h>        // for OSSL_PARAM_OCTET_STRING, OSSL_PARAM_...
 #include <openssl/core_names.h>  // for OSSL_KDF_PARAM_ITER, OSSL_KDF_PARAM_...
+#include <openssl/crypto.h>      // for CRYPTO_secure_malloc_init
 #include <openssl/evp.h>         // for EVP_CIPHER_CTX_new, EVP_CIPHER_CTX_s...
 #include <openssl/kdf.h>         // for EVP_KDF_CTX_new, EVP_KDF_derive, EVP...
+#include <openssl/rand.h>        // for RAND_bytes, RAND_priv_bytes
 #include <openssl/types.h>       // for EVP_CIPHER, EVP_CIPHER_CTX, EVP_KDF
+#include <stdio.h>               // for stderr
+#include <algorithm>             // for clamp
+#include <bit>                   // for bit_floor, has_single_bit
 #include <cassert>               // for assert
-#include <cstring>               // for NULL, memcmp, size_t
-#include <fstream>               // for basic_ifstream, basic_istream::read
-#include <stdexcept>             // for runtime_error
+#include <cstdint>               // for uint32_t, uint64_t, INT32_MAX
+#include <cstring>               // for NULL, memcmp, memcpy, size_t
+#include <fstream>               // for ifstream, basic_istream::read
+#include <istream>               // for istream
+#include <list>                  // for list
+#include <mutex>                 // for mutex, lock_guard
+#include <ostream>               // for ostream
+#include <stdexcept>             // for runtime_error, invalid_argument
+#include <unordered_map>         // for unordered_map
+#include <utility>               // for move, pair
 
+#include "genpass/detail/HmacSha256.hpp"   // for HmacSha256
+#include "genpass/detail/atomicWrite.hpp"  // for atomicWrite
+#include "genpass/detail/instrument.hpp"   // for GENPASS_COUNT, GENPASS_TIME
 #include "genpass/detail/ossl_ptr.hpp"     // for ossl_unique_ptr
+#include "genpass/detail/secureAlloc.hpp"  // for SecureBuffer
+#include "genpass/detail/serialize.hpp"    // for serialize, deserialize
 
 namespace genpass {
 
@@ -38,29 +57,264 @@ static const unsigned char saltMagic[] = "Salted__";
 static const std::size_t saltLen = PKCS5_SALT_LEN;
 static const unsigned int kdfIterations = 1 << 13;
 static const char cipherAlgStr[] = "AES-256-ECB";
+static const std::size_t cipherBlockLen = 16;
 static const std::size_t seedLen = 256 / 8;
+static const char macAlgStr[] = "HMAC";
+static const char macDigestStr[] = "SHA256";
 
-Seed
-Seed::fromEncryptedFile(
-  const std::filesystem::path& file,
-  const std::string& password
-) {
-  // setup input stream
-  std::basic_ifstream<unsigned char> in(file);
-  in.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+// Seed files written by writeEncryptedFile:
+//   magic "GPSEED\0\0", version, kdf, iterations, memoryKiB, parallelism
+//   (little-endian 32-bit), salt, nonce, encrypted seed, GCM tag
+// Everything before the encrypted seed is authenticated with it.
+static const unsigned char fileMagic[8] = {
+  'G', 'P', 'S', 'E', 'E', 'D', '\0', '\0'};
+static const std::uint32_t fileVersion = 1;
+static const std::size_t fileSaltLen = 16;
+static const std::size_t nonceLen = 12;
+static const std::size_t tagLen = 16;
+static const std::size_t fileKeyLen = 256 / 8;
+static const std::size_t paramsOffset = sizeof(fileMagic) + 4;
+static const std::size_t saltOffset = paramsOffset + 4 * 4;
+static const std::size_t headerLen = saltOffset + fileSaltLen + nonceLen;
+static const std::size_t fileLen = headerLen + seedLen + tagLen;
+static const char fileCipherAlgStr[] = "AES-256-GCM";
+static const char fileDigestStr[] = "SHA256";
+// bounds on the parameters, so that a damaged header cannot ask for more
+// than a machine has
+static const std::uint32_t maxMemoryKiB = 1 << 22;
+static const std::uint32_t maxParallelism = 1 << 10;
+
+// HKDF info prefix for child seeds, so that no other use of the seed as an
+// HKDF key can collide with them
+static const char deriveInfoPrefix[] = "genpass seed child\0";
+static const std::size_t defaultChildCacheSize = 64;
+
+// The most recently derived children of a seed, by label.
+class Seed::ChildCache {
+public:
+  using Child = std::shared_ptr<const Seed>;
+
+  std::mutex mutex;
+  std::size_t capacity = defaultChildCacheSize;
+  // most recently used first
+  std::list<std::pair<std::string, Child>> order;
+  std::unordered_map<std::string, decltype(order)::iterator> byLabel;
+
+  // Must hold `mutex`.
+  Child find(const std::string& label) {
+    const auto it = byLabel.find(label);
+    if(it == byLabel.end()) return nullptr;
+    order.splice(order.begin(), order, it->second);
+    return it->second->second;
+  }
+
+  // Must hold `mutex`. Returns the cached child if another thread got there
+  // first.
+  Child insert(const std::string& label, Child&& child) {
+    if(Child existing = find(label)) return existing;
+    if(!capacity) return std::move(child);
+    order.emplace_front(label, std::move(child));
+    byLabel.emplace(label, order.begin());
+    trim();
+    return order.front().second;
+  }
+
+  // Must hold `mutex`.
+  void trim() {
+    while(order.size() > capacity) {
+      byLabel.erase(order.back().first);
+      order.pop_back();
+    }
+  }
+};
+
+static Seed::EVP_MAC_CTX_ptr
+newKeyedMac(EVP_SKEY *key) {
+  GENPASS_COUNT("openssl.fetch", 0);
+  ossl_unique_ptr<EVP_MAC> macAlg(
+    EVP_MAC_fetch(NULL, macAlgStr, NULL),
+    &EVP_MAC_free
+  );
+  if(!macAlg)
+    throw std::runtime_error("failed to fetch MAC algorithm");
+
+  Seed::EVP_MAC_CTX_ptr mac(EVP_MAC_CTX_new(macAlg.get()), &EVP_MAC_CTX_free);
+  if(!mac)
+    throw std::runtime_error("failed to create MAC context");
 
-  { // read and verify magic number
-    unsigned char magicBuf[sizeof(saltMagic) - 1];
-    in.read(magicBuf, sizeof(magicBuf));
-    if(std::memcmp(magicBuf, saltMagic, sizeof(magicBuf)))
-      throw std::runtime_error("bad magic number");
+  OSSL_PARAM macParams[] = {
+    {OSSL_MAC_PARAM_DIGEST, OSSL_PARAM_UTF8_STRING,
+      const_cast<char *>(macDigestStr), sizeof(macDigestStr) - 1, 0},
+    {NULL, 0, NULL, 0, 0}
+  };
+  if(!EVP_MAC_init_SKEY(mac.get(), key, macParams))
+    throw std::runtime_error("failure in MAC initialization");
+
+  return mac;
+}
+
+#ifdef GENPASS_BUILTIN_HMAC
+// Cross-checks the built-in HMAC against OpenSSL with the actual key, over
+// messages of one to three blocks in every lane.
+static bool
+hmacEngineAgrees(const detail::HmacSha256& engine, EVP_MAC_CTX *macTemplate) {
+  constexpr std::size_t lanes = detail::HmacSha256::lanes;
+  static const std::size_t lens[lanes] = {0, 4, 55, 56, 63, 64, 119, 150};
+  unsigned char msgBuf[150];
+  for(std::size_t i = 0; i < sizeof(msgBuf); i++) msgBuf[i] = (unsigned char)i;
+
+  const unsigned char *msgs[lanes];
+  unsigned char outBuf[lanes][detail::HmacSha256::macSize];
+  unsigned char *outs[lanes];
+  for(std::size_t lane = 0; lane < lanes; lane++) {
+    msgs[lane] = msgBuf;
+    outs[lane] = outBuf[lane];
+  }
+  engine.macMulti(lanes, msgs, lens, outs);
+
+  ossl_unique_ptr<EVP_MAC_CTX> mac(EVP_MAC_CTX_dup(macTemplate),
+    &EVP_MAC_CTX_free);
+  if(!mac) return false;
+  for(std::size_t lane = 0; lane < lanes; lane++) {
+    unsigned char expected[EVP_MAX_MD_SIZE];
+    std::size_t expectedLen;
+    if(!EVP_MAC_init(mac.get(), NULL, 0, NULL)
+        || !EVP_MAC_update(mac.get(), msgBuf, lens[lane])
+        || !EVP_MAC_final(mac.get(), expected, &expectedLen, sizeof(expected))
+        || expectedLen != detail::HmacSha256::macSize
+        || std::memcmp(expected, outBuf[lane], expectedLen))
+      return false;
   }
+  return true;
+}
+#endif
+
+static std::unique_ptr<const detail::HmacSha256>
+newHmacEngine(EVP_SKEY *key, EVP_MAC_CTX *macTemplate) {
+#ifdef GENPASS_BUILTIN_HMAC
+  // the self test is of the kernel, not the key, so warn only once
+  static const bool selfTestPassed = [] {
+    const bool passed = detail::HmacSha256::selfTest();
+    if(!passed) fmt::println(stderr, "warning: built-in HMAC failed its self"
+      " test; falling back to OpenSSL");
+    return passed;
+  }();
+  if(!selfTestPassed) return nullptr;
 
+  const unsigned char *rawKey;
+  std::size_t rawKeyLen;
+  if(!EVP_SKEY_get0_raw_key(key, &rawKey, &rawKeyLen))
+    return nullptr; // the key is opaque to us
+
+  auto engine = std::make_unique<const detail::HmacSha256>(rawKey, rawKeyLen);
+  if(!hmacEngineAgrees(*engine, macTemplate)) {
+    fmt::println(stderr, "warning: built-in HMAC does not agree with OpenSSL;"
+      " falling back to OpenSSL");
+    return nullptr;
+  }
+  return engine;
+#else
+  return nullptr;
+#endif
+}
+
+Seed::Seed(EVP_SKEY_ptr&& key)
+  : key(std::move(key)), macTemplate(newKeyedMac(this->key.get())),
+    hmacEngine(newHmacEngine(this->key.get(), macTemplate.get())),
+    children(std::make_unique<ChildCache>())
+{ }
+
+Seed::~Seed() = default;
+
+Seed::EVP_MAC_CTX_ptr
+Seed::newMac() const {
+  GENPASS_COUNT("openssl.macDup", 0);
+  EVP_MAC_CTX_ptr mac(EVP_MAC_CTX_dup(macTemplate.get()), &EVP_MAC_CTX_free);
+  if(!mac)
+    throw std::runtime_error("failed to duplicate MAC context");
+  return mac;
+}
+
+std::shared_ptr<const Seed>
+Seed::derive(std::string_view label) const {
+  const std::string labelStr(label);
+  {
+    const std::lock_guard<std::mutex> lock(children->mutex);
+    if(ChildCache::Child cached = children->find(labelStr)) {
+      GENPASS_COUNT("seed.deriveCached", 0);
+      return cached;
+    }
+  }
+
+  // derive without the lock, so that other lookups need not wait
+  GENPASS_TIME("seed.derive", seedLen);
+  const unsigned char *parentRaw;
+  std::size_t parentLen;
+  if(!EVP_SKEY_get0_raw_key(key.get(), &parentRaw, &parentLen))
+    throw std::runtime_error("failed to export seed");
+
+  std::string info(deriveInfoPrefix, sizeof(deriveInfoPrefix) - 1);
+  info += label;
+
+  GENPASS_COUNT("openssl.fetch", 0);
+  ossl_unique_ptr<EVP_KDF> kdfAlg(EVP_KDF_fetch(NULL, "HKDF", NULL),
+    &EVP_KDF_free);
+  if(!kdfAlg) throw std::runtime_error("failed to fetch HKDF algorithm");
+  ossl_unique_ptr<EVP_KDF_CTX> kdf(EVP_KDF_CTX_new(kdfAlg.get()),
+    &EVP_KDF_CTX_free);
+  if(!kdf) throw std::runtime_error("failed to create HKDF context");
+
+  OSSL_PARAM kdfParams[] = {
+    {OSSL_KDF_PARAM_DIGEST, OSSL_PARAM_UTF8_STRING,
+      const_cast<char *>(macDigestStr), sizeof(macDigestStr) - 1, 0},
+    {OSSL_KDF_PARAM_KEY, OSSL_PARAM_OCTET_STRING,
+      const_cast<unsigned char *>(parentRaw), parentLen, 0},
+    {OSSL_KDF_PARAM_INFO, OSSL_PARAM_OCTET_STRING,
+      info.data(), info.length(), 0},
+    {NULL, 0, NULL, 0, 0}
+  };
+  const detail::SecureBuffer childRaw(seedLen);
+  if(!EVP_KDF_derive(kdf.get(), childRaw.data(), seedLen, kdfParams))
+    throw std::runtime_error("failed to derive child seed");
+
+  ossl_unique_ptr<EVP_SKEY> childKey(
+    EVP_SKEY_import_raw_key(NULL, NULL, childRaw.data(), seedLen, NULL),
+    &EVP_SKEY_free
+  );
+  if(!childKey) throw std::runtime_error("failed to create SKEY");
+  ChildCache::Child child = std::make_shared<const Seed>(std::move(childKey));
+
+  const std::lock_guard<std::mutex> lock(children->mutex);
+  return children->insert(labelStr, std::move(child));
+}
+
+void
+Seed::setDeriveCacheSize(std::size_t size) const {
+  const std::lock_guard<std::mutex> lock(children->mutex);
+  children->capacity = size;
+  children->trim();
+}
+
+bool
+Seed::initSecureHeap(std::size_t bytes) {
+  if(!std::has_single_bit(bytes) || bytes < seedLen)
+    throw std::invalid_argument(
+      "secure heap size must be a power of two of at least the seed size");
+  if(CRYPTO_secure_malloc_initialized()) return true;
+  // the smallest block is one seed, since that's what most keys are
+  return CRYPTO_secure_malloc_init(bytes, seedLen) != 0;
+}
+
+// Reads the key from the rest of an OpenSSL `enc -aes-256-ecb -pbkdf2` file,
+// after the magic number.
+static ossl_unique_ptr<EVP_SKEY>
+fromSaltedFile(std::istream& in, std::string_view password) {
   // read salt
   unsigned char salt[saltLen];
-  in.read(salt, saltLen);
+  in.read((char *)salt, saltLen);
 
   // fetch KDF
+  GENPASS_COUNT("openssl.fetch", 0);
   ossl_unique_ptr<EVP_KDF> kdfAlg(
     EVP_KDF_fetch(NULL, "PBKDF2", NULL),
     &EVP_KDF_free);
@@ -72,6 +326,7 @@ Seed::fromEncryptedFile(
   if(!kdf) throw std::runtime_error("failed to create PBKDF2 context");
 
   // fetch cipher
+  GENPASS_COUNT("openssl.fetch", 0);
   ossl_unique_ptr<EVP_CIPHER> cipherAlg(
     EVP_CIPHER_fetch(NULL, cipherAlgStr, NULL),
     &EVP_CIPHER_free);
@@ -81,22 +336,25 @@ Seed::fromEncryptedFile(
   // query cipher parameters
   const int ivLen = EVP_CIPHER_get_iv_length(cipherAlg.get());
   const int keyLen = EVP_CIPHER_get_key_length(cipherAlg.get());
-  assert(EVP_CIPHER_get_block_size(cipherAlg.get()) == 16);
+  assert(EVP_CIPHER_get_block_size(cipherAlg.get()) == cipherBlockLen);
   if(ivLen < 0) throw std::runtime_error("failed to get IV length");
 
   // derive key
   OSSL_PARAM kdfParams[] = {
     {OSSL_KDF_PARAM_PASSWORD, OSSL_PARAM_OCTET_STRING,
-      const_cast<std::string&>(password).data(), password.length(), 0},
+      const_cast<char *>(password.data()), password.length(), 0},
     {OSSL_KDF_PARAM_SALT, OSSL_PARAM_OCTET_STRING,
       &salt, saltLen, 0},
     {OSSL_KDF_PARAM_ITER, OSSL_PARAM_UNSIGNED_INTEGER,
       &const_cast<unsigned int&>(kdfIterations), sizeof(kdfIterations), 0},
     {NULL, 0, NULL, 0, 0}
   };
-  unsigned char ivkey[ivLen + keyLen];
-  if(!EVP_KDF_derive(kdf.get(), ivkey, ivLen + keyLen, kdfParams))
-    throw std::runtime_error("failed to derive decryption key");
+  const detail::SecureBuffer ivkey(ivLen + keyLen);
+  {
+    GENPASS_TIME("seed.pbkdf2", ivLen + keyLen);
+    if(!EVP_KDF_derive(kdf.get(), ivkey.data(), ivkey.size(), kdfParams))
+      throw std::runtime_error("failed to derive decryption key");
+  }
 
   // create cipher
   ossl_unique_ptr<EVP_CIPHER_CTX> cipherCtx(EVP_CIPHER_CTX_new(),
@@ -106,31 +364,405 @@ Seed::fromEncryptedFile(
   EVP_CIPHER_CTX_set_padding(cipherCtx.get(), 1);
 
   // initialize cipher
-  if(!EVP_DecryptInit_ex2(cipherCtx.get(), cipherAlg.get(), ivkey + ivLen,
-      ivkey, NULL))
+  if(!EVP_DecryptInit_ex2(cipherCtx.get(), cipherAlg.get(),
+      ivkey.data() + ivLen, ivkey.data(), NULL))
     throw std::runtime_error("failed to initialize decryption context");
 
-  // read encrypted seed
-  unsigned char seedRaw[seedLen];
-  in.read(seedRaw, seedLen);
+  // read encrypted seed; the padding makes it one block longer than the seed
+  unsigned char seedEnc[seedLen + cipherBlockLen];
+  in.read((char *)seedEnc, sizeof(seedEnc));
 
   // decrypt seed
-  int tmp;
-  if(!EVP_DecryptUpdate(cipherCtx.get(), seedRaw, &tmp, seedRaw, seedLen))
+  const detail::SecureBuffer seedRaw(seedLen + cipherBlockLen);
+  int updateLen, finalLen;
+  if(!EVP_DecryptUpdate(cipherCtx.get(), seedRaw.data(), &updateLen,
+      seedEnc, sizeof(seedEnc)))
     throw std::runtime_error("failed to decrypt");
-  assert(tmp == seedLen);
-  if(!EVP_DecryptFinal(cipherCtx.get(), NULL, &tmp))
+  if(!EVP_DecryptFinal(cipherCtx.get(), seedRaw.data() + updateLen,
+      &finalLen))
     throw std::runtime_error(
       "failed to finalize decryption. (Make sure the password is correct!)");
-  assert(tmp == 0);
+  if((std::size_t)(updateLen + finalLen) != seedLen)
+    throw std::runtime_error("bad seed length");
+
+  ossl_unique_ptr<EVP_SKEY> seedKey(
+    EVP_SKEY_import_raw_key(NULL, NULL, seedRaw.data(), seedLen, NULL),
+    &EVP_SKEY_free
+  );
+  if(!seedKey) throw std::runtime_error("failed to create SKEY");
+
+  return seedKey;
+}
+
+void
+SeedKdfParams::check() const {
+  switch(kdf) {
+  case SeedKdf::pbkdf2:
+    if(!iterations)
+      throw std::invalid_argument("PBKDF2 needs at least one iteration");
+    if(memoryKiB || parallelism != 1)
+      throw std::invalid_argument("PBKDF2 takes no memory or parallelism");
+    return;
+  case SeedKdf::scrypt:
+    if(iterations) throw std::invalid_argument("scrypt takes no iterations");
+    if(memoryKiB < 2 || memoryKiB > maxMemoryKiB
+        || !std::has_single_bit(memoryKiB))
+      throw std::invalid_argument(fmt::format(
+        "scrypt N must be a power of two from 2 to {}", maxMemoryKiB));
+    if(!parallelism || parallelism > maxParallelism)
+      throw std::invalid_argument(fmt::format(
+        "scrypt p must be from 1 to {}", maxParallelism));
+    return;
+  case SeedKdf::argon2id:
+    if(!iterations)
+      throw std::invalid_argument("Argon2id needs at least one iteration");
+    if(!parallelism || parallelism > maxParallelism)
+      throw std::invalid_argument(fmt::format(
+        "Argon2id lanes must be from 1 to {}", maxParallelism));
+    if(memoryKiB < 8 * parallelism || memoryKiB > maxMemoryKiB)
+      throw std::invalid_argument(fmt::format(
+        "Argon2id memory must be from 8 KiB per lane to {} KiB",
+        maxMemoryKiB));
+    return;
+  }
+  throw std::invalid_argument("unknown seed KDF");
+}
+
+// Derives `outLen` bytes of key from `password` with the KDF in `params`,
+// which must have been checked.
+static void
+deriveKey(
+  const SeedKdfParams& params,
+  std::string_view password,
+  const unsigned char *salt,
+  std::size_t saltLen,
+  unsigned char *out,
+  std::size_t outLen
+) {
+  static const char *const kdfNames[] = {NULL, "PBKDF2", "SCRYPT", "ARGON2ID"};
+  const char *const kdfName = kdfNames[(std::uint32_t)params.kdf];
+
+  GENPASS_COUNT("openssl.fetch", 0);
+  ossl_unique_ptr<EVP_KDF> kdfAlg(EVP_KDF_fetch(NULL, kdfName, NULL),
+    &EVP_KDF_free);
+  if(!kdfAlg) throw std::runtime_error(
+    fmt::format("failed to fetch {} algorithm", kdfName));
+  ossl_unique_ptr<EVP_KDF_CTX> kdf(EVP_KDF_CTX_new(kdfAlg.get()),
+    &EVP_KDF_CTX_free);
+  if(!kdf) throw std::runtime_error(
+    fmt::format("failed to create {} context", kdfName));
+
+  // OSSL_PARAMs point at mutable values
+  std::uint32_t iterations = params.iterations;
+  std::uint32_t memoryKiB = params.memoryKiB;
+  std::uint32_t parallelism = params.parallelism;
+  // scrypt's r, and the memory it needs for the given N, r and p
+  std::uint64_t scryptN = memoryKiB;
+  std::uint32_t scryptR = 8;
+  std::uint64_t scryptMaxMem =
+    (std::uint64_t)128 * scryptR * (scryptN + parallelism + 2);
+
+  OSSL_PARAM kdfParams[7] = {
+    {OSSL_KDF_PARAM_PASSWORD, OSSL_PARAM_OCTET_STRING,
+      const_cast<char *>(password.data()), password.length(), 0},
+    {OSSL_KDF_PARAM_SALT, OSSL_PARAM_OCTET_STRING,
+      const_cast<unsigned char *>(salt), saltLen, 0},
+  };
+  OSSL_PARAM *param = kdfParams + 2;
+  const auto uintParam = [&](const char *key, auto& value) {
+    *param++ = {key, OSSL_PARAM_UNSIGNED_INTEGER, &value, sizeof(value), 0};
+  };
+  switch(params.kdf) {
+  case SeedKdf::pbkdf2:
+    *param++ = {OSSL_KDF_PARAM_DIGEST, OSSL_PARAM_UTF8_STRING,
+      const_cast<char *>(fileDigestStr), sizeof(fileDigestStr) - 1, 0};
+    uintParam(OSSL_KDF_PARAM_ITER, iterations);
+    break;
+  case SeedKdf::scrypt:
+    uintParam(OSSL_KDF_PARAM_SCRYPT_N, scryptN);
+    uintParam(OSSL_KDF_PARAM_SCRYPT_R, scryptR);
+    uintParam(OSSL_KDF_PARAM_SCRYPT_P, parallelism);
+    uintParam(OSSL_KDF_PARAM_SCRYPT_MAXMEM, scryptMaxMem);
+    break;
+  case SeedKdf::argon2id:
+    // the lanes are computed one after another, since OpenSSL only uses
+    // threads when the application has set up a thread pool
+    uintParam(OSSL_KDF_PARAM_ITER, iterations);
+    uintParam(OSSL_KDF_PARAM_ARGON2_MEMCOST, memoryKiB);
+    uintParam(OSSL_KDF_PARAM_ARGON2_LANES, parallelism);
+    break;
+  }
+  *param = OSSL_PARAM{NULL, 0, NULL, 0, 0};
+
+  GENPASS_TIME("seed.kdf", outLen);
+  if(!EVP_KDF_derive(kdf.get(), out, outLen, kdfParams))
+    throw std::runtime_error(
+      fmt::format("failed to derive key with {}", kdfName));
+}
+
+// Encrypts (`encrypt`) or decrypts with AES-256-GCM, authenticating `aad`
+// as well. Returns false if decryption fails to authenticate.
+static bool
+runGcm(
+  bool encrypt,
+  const unsigned char *key,
+  const unsigned char *nonce,
+  const unsigned char *aad,
+  std::size_t aadLen,
+  const unsigned char *in,
+  std::size_t len,
+  unsigned char *out,
+  unsigned char *tag
+) {
+  GENPASS_COUNT("openssl.fetch", 0);
+  ossl_unique_ptr<EVP_CIPHER> cipherAlg(
+    EVP_CIPHER_fetch(NULL, fileCipherAlgStr, NULL),
+    &EVP_CIPHER_free);
+  if(!cipherAlg) throw std::runtime_error("failed to fetch AES-256-GCM");
+  ossl_unique_ptr<EVP_CIPHER_CTX> cipher(EVP_CIPHER_CTX_new(),
+    &EVP_CIPHER_CTX_free);
+  if(!cipher) throw std::runtime_error("failed to create cipher context");
+  assert(EVP_CIPHER_get_iv_length(cipherAlg.get()) == (int)nonceLen);
+
+  int outLen, finalLen;
+  if(!EVP_CipherInit_ex2(cipher.get(), cipherAlg.get(), key, nonce, encrypt,
+        NULL)
+      || !EVP_CipherUpdate(cipher.get(), NULL, &outLen, aad, aadLen)
+      || !EVP_CipherUpdate(cipher.get(), out, &outLen, in, len))
+    throw std::runtime_error("failure in seed encryption");
+  if(!encrypt && !EVP_CIPHER_CTX_ctrl(cipher.get(), EVP_CTRL_AEAD_SET_TAG,
+      tagLen, tag))
+    throw std::runtime_error("failure in seed encryption");
+  if(!EVP_CipherFinal_ex(cipher.get(), out + outLen, &finalLen)) {
+    if(!encrypt) return false;
+    throw std::runtime_error("failure in seed encryption");
+  }
+  if(encrypt && !EVP_CIPHER_CTX_ctrl(cipher.get(), EVP_CTRL_AEAD_GET_TAG,
+      tagLen, tag))
+    throw std::runtime_error("failure in seed encryption");
+  return true;
+}
+
+// Reads the parameters from a seed file header.
+static SeedKdfParams
+parseHeader(const unsigned char *header) {
+  std::uint32_t version, kdf;
+  deserialize(version, header + sizeof(fileMagic));
+  if(version != fileVersion) throw std::runtime_error(
+    fmt::format("unsupported seed file version: {}", version));
+
+  SeedKdfParams params;
+  const unsigned char *field = header + paramsOffset;
+  field += deserialize(kdf, field);
+  field += deserialize(params.iterations, field);
+  field += deserialize(params.memoryKiB, field);
+  deserialize(params.parallelism, field);
+  params.kdf = (SeedKdf)kdf;
+  try {
+    params.check();
+  } catch(const std::invalid_argument& e) {
+    throw std::runtime_error(
+      fmt::format("bad seed file header: {}", e.what()));
+  }
+  return params;
+}
+
+// Reads the key from the rest of a file written by writeEncryptedFile, after
+// the magic number.
+static ossl_unique_ptr<EVP_SKEY>
+fromSeedFile(std::istream& in, std::string_view password) {
+  unsigned char data[fileLen];
+  std::memcpy(data, fileMagic, sizeof(fileMagic));
+  in.read((char *)data + sizeof(fileMagic), fileLen - sizeof(fileMagic));
+  const SeedKdfParams params = parseHeader(data);
+
+  const detail::SecureBuffer fileKey(fileKeyLen);
+  deriveKey(params, password, data + saltOffset, fileSaltLen,
+    fileKey.data(), fileKey.size());
+  const detail::SecureBuffer seedRaw(seedLen);
+  if(!runGcm(false, fileKey.data(), data + saltOffset + fileSaltLen,
+      data, headerLen, data + headerLen, seedLen, seedRaw.data(),
+      data + headerLen + seedLen))
+    throw std::runtime_error(
+      "failed to decrypt seed. (Make sure the password is correct!)");
 
   ossl_unique_ptr<EVP_SKEY> seedKey(
-    EVP_SKEY_import_raw_key(NULL, NULL, seedRaw, seedLen, NULL),
+    EVP_SKEY_import_raw_key(NULL, NULL, seedRaw.data(), seedLen, NULL),
     &EVP_SKEY_free
   );
   if(!seedKey) throw std::runtime_error("failed to create SKEY");
 
+  return seedKey;
+}
+
+Seed
+Seed::random() {
+  const detail::SecureBuffer seedRaw(seedLen);
+  if(RAND_priv_bytes(seedRaw.data(), seedLen) != 1)
+    throw std::runtime_error("failed to generate seed");
+  ossl_unique_ptr<EVP_SKEY> seedKey(
+    EVP_SKEY_import_raw_key(NULL, NULL, seedRaw.data(), seedLen, NULL),
+    &EVP_SKEY_free
+  );
+  if(!seedKey) throw std::runtime_error("failed to create SKEY");
   return Seed(std::move(seedKey));
 }
 
+// The key in a seed file of either format.
+static ossl_unique_ptr<EVP_SKEY>
+readSeedFile(
+  const std::filesystem::path& file,
+  std::string_view password
+) {
+  GENPASS_TIME("seed.fromEncryptedFile", 0);
+
+  // setup input stream
+  std::ifstream in(file, std::ios_base::binary);
+  in.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+
+  // read the magic number, which tells the two formats apart
+  static_assert(sizeof(saltMagic) - 1 == sizeof(fileMagic));
+  unsigned char magicBuf[sizeof(fileMagic)];
+  in.read((char *)magicBuf, sizeof(magicBuf));
+  if(!std::memcmp(magicBuf, fileMagic, sizeof(magicBuf)))
+    return fromSeedFile(in, password);
+  if(!std::memcmp(magicBuf, saltMagic, sizeof(magicBuf)))
+    return fromSaltedFile(in, password);
+  throw std::runtime_error("bad magic number");
+}
+
+Seed
+Seed::fromEncryptedFile(
+  const std::filesystem::path& file,
+  const std::string& password
+) {
+  return Seed(readSeedFile(file, password));
+}
+
+std::shared_ptr<const Seed>
+Seed::sharedFromEncryptedFile(
+  const std::filesystem::path& file,
+  std::string_view password
+) {
+  return std::make_shared<const Seed>(readSeedFile(file, password));
+}
+
+void
+Seed::writeEncryptedFile(
+  const std::filesystem::path& file,
+  const std::string& password,
+  const SeedKdfParams& params
+) const {
+  params.check();
+  const unsigned char *seedRaw;
+  std::size_t seedRawLen;
+  if(!EVP_SKEY_get0_raw_key(key.get(), &seedRaw, &seedRawLen))
+    throw std::runtime_error("failed to export seed");
+  if(seedRawLen != seedLen)
+    throw std::invalid_argument("seed files only hold 256-bit seeds");
+
+  unsigned char data[fileLen];
+  std::memcpy(data, fileMagic, sizeof(fileMagic));
+  serialize(data + sizeof(fileMagic), fileVersion);
+  unsigned char *field = data + paramsOffset;
+  field += serialize(field, (std::uint32_t)params.kdf);
+  field += serialize(field, params.iterations);
+  field += serialize(field, params.memoryKiB);
+  serialize(field, params.parallelism);
+  if(RAND_bytes(data + saltOffset, fileSaltLen + nonceLen) != 1)
+    throw std::runtime_error("failed to generate salt");
+
+  const detail::SecureBuffer fileKey(fileKeyLen);
+  deriveKey(params, password, data + saltOffset, fileSaltLen,
+    fileKey.data(), fileKey.size());
+  runGcm(true, fileKey.data(), data + saltOffset + fileSaltLen, data,
+    headerLen, seedRaw, seedLen, data + headerLen, data + headerLen + seedLen);
+
+  detail::atomicWrite(file, [&](std::ostream& out) {
+    out.write((const char *)data, sizeof(data));
+  });
+}
+
+SeedKdfParams
+Seed::readKdfParams(const std::filesystem::path& file) {
+  std::ifstream in(file, std::ios_base::binary);
+  in.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+  unsigned char header[headerLen];
+  in.read((char *)header, sizeof(fileMagic));
+
+  if(!std::memcmp(header, saltMagic, sizeof(fileMagic)))
+    return SeedKdfParams{SeedKdf::pbkdf2, kdfIterations, 0, 1};
+  if(std::memcmp(header, fileMagic, sizeof(fileMagic)))
+    throw std::runtime_error("bad magic number");
+  in.read((char *)header + sizeof(fileMagic), headerLen - sizeof(fileMagic));
+  return parseHeader(header);
+}
+
+// Times one derivation with `params`.
+static std::chrono::nanoseconds
+timeKdf(const SeedKdfParams& params) {
+  const unsigned char salt[fileSaltLen] = {};
+  unsigned char out[fileKeyLen];
+  const auto start = std::chrono::steady_clock::now();
+  deriveKey(params, "calibration", salt, sizeof(salt), out, sizeof(out));
+  return std::chrono::steady_clock::now() - start;
+}
+
+// `count` scaled by `target / took`, within [1, `max`].
+static std::uint32_t
+scaleCost(
+  std::uint32_t count,
+  std::chrono::nanoseconds target,
+  std::chrono::nanoseconds took,
+  std::uint32_t max
+) {
+  const double scaled =
+    (double)count * target.count() / std::max<std::int64_t>(took.count(), 1);
+  return (std::uint32_t)std::clamp(scaled, 1.0, (double)max);
+}
+
+SeedKdfParams
+Seed::calibrateKdf(
+  SeedKdf kdf,
+  std::chrono::milliseconds target,
+  std::uint32_t memoryKiB
+) {
+  if(target.count() <= 0)
+    throw std::invalid_argument("calibration target must be positive");
+  const std::chrono::nanoseconds goal = target;
+  SeedKdfParams params{kdf, 1, 0, 1};
+  std::chrono::nanoseconds took;
+
+  switch(kdf) {
+  case SeedKdf::pbkdf2:
+    // time enough iterations that the clock's resolution does not matter
+    params.iterations = 1 << 10;
+    while((took = timeKdf(params)) < goal / 8
+        && params.iterations <= (std::uint32_t)INT32_MAX)
+      params.iterations *= 2;
+    params.iterations =
+      scaleCost(params.iterations, goal, took, UINT32_MAX);
+    break;
+
+  case SeedKdf::scrypt:
+    params.iterations = 0;
+    params.memoryKiB = std::bit_floor(std::clamp(memoryKiB, 2u, maxMemoryKiB));
+    while((took = timeKdf(params)) > goal && params.memoryKiB > 2)
+      params.memoryKiB /= 2;
+    params.parallelism = scaleCost(1, goal, took, maxParallelism);
+    break;
+
+  case SeedKdf::argon2id:
+    params.memoryKiB = std::clamp(memoryKiB, 8u, maxMemoryKiB);
+    while((took = timeKdf(params)) > goal && params.memoryKiB >= 16)
+      params.memoryKiB /= 2;
+    params.iterations = scaleCost(1, goal, took, UINT32_MAX);
+    break;
+
+  default:
+    throw std::invalid_argument("unknown seed KDF");
+  }
+  return params;
+}
+
 } // namespace genpass
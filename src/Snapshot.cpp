@@ -0,0 +1,87 @@
+/* ---------------------------------------------------------------------- *\
+ * src/Snapshot.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/Snapshot.hpp"
+
+#include <fmt/format.h>  // for format
+#include <algorithm>     // for lower_bound
+#include <stdexcept>     // for out_of_range
+
+#include "genpass/detail/generateBatch.hpp"  // for generateBatch, generateB...
+
+namespace genpass {
+
+Snapshot::Snapshot(Entries&& entries, std::uint64_t version,
+  unsigned threadCount
+) : entries(std::move(entries)), version(version), threadCount(threadCount)
+{ }
+
+const Password *
+Snapshot::findPassword(std::string_view id) const {
+  const auto it = std::lower_bound(entries.begin(), entries.end(), id,
+    [](const auto& entry, std::string_view id) { return entry->id < id; });
+  return it != entries.end() && (*it)->id == id ? it->get() : NULL;
+}
+
+const Password&
+Snapshot::getPassword(std::string_view id) const {
+  const Password *password = findPassword(id);
+  if(!password)
+    throw std::out_of_range(fmt::format("no password with ID: {}", id));
+  return *password;
+}
+
+std::vector<std::string>
+Snapshot::generate(const Seed& seed,
+  const std::vector<std::string>& ids
+) const {
+  std::vector<const Password *> batch;
+  batch.reserve(ids.size());
+  for(const std::string& id : ids) batch.push_back(&getPassword(id));
+  return detail::generateBatch(seed, batch, threadCount);
+}
+
+std::vector<SecureString>
+Snapshot::generateSecure(const Seed& seed,
+  const std::vector<std::string>& ids
+) const {
+  std::vector<const Password *> batch;
+  batch.reserve(ids.size());
+  for(const std::string& id : ids) batch.push_back(&getPassword(id));
+  return detail::generateBatchSecure(seed, batch, threadCount);
+}
+
+std::vector<std::pair<std::string, std::string>>
+Snapshot::generateAll(const Seed& seed) const {
+  std::vector<const Password *> batch;
+  batch.reserve(entries.size());
+  for(const auto& entry : entries) batch.push_back(entry.get());
+
+  std::vector<std::string> generated =
+    detail::generateBatch(seed, batch, threadCount);
+
+  std::vector<std::pair<std::string, std::string>> ret;
+  ret.reserve(batch.size());
+  for(std::size_t i = 0; i < batch.size(); i++)
+    ret.emplace_back(batch[i]->id, std::move(generated[i]));
+  return ret;
+}
+
+} // namespace genpass
@@ -0,0 +1,242 @@
+/* ---------------------------------------------------------------------- *\
+ * src/VaultFile.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/VaultFile.hpp"
+
+#include <errno.h>            // for errno
+#include <fcntl.h>            // for open, O_RDONLY, O_CLOEXEC
+#include <fmt/format.h>       // for format
+#include <nlohmann/json.hpp>  // for basic_json
+#include <sys/mman.h>         // for mmap, munmap, MAP_FAILED
+#include <sys/stat.h>         // for fstat
+#include <unistd.h>           // for close
+#include <algorithm>          // for sort
+#include <cstring>            // for memcmp, memcpy
+#include <ostream>            // for ostream
+#include <stdexcept>          // for runtime_error, out_of_range
+#include <system_error>       // for system_error, generic_category
+#include <utility>            // for move
+
+#include "genpass/detail/atomicWrite.hpp"  // for atomicWrite
+#include "genpass/detail/serialize.hpp"    // for serialize, deserialize
+
+namespace genpass {
+
+static const unsigned char vaultMagic[8] = {
+  'G', 'P', 'V', 'A', 'U', 'L', 'T', '\0'};
+static const std::uint32_t vaultVersion = 1;
+static const std::size_t headerLen = sizeof(vaultMagic) + 4 + 4;
+static const std::size_t indexEntryLen = 8 + 8 + 4 + 4;
+
+VaultFile::VaultFile(const std::filesystem::path& file)
+  : map(NULL), mapLen(0), count(0)
+{
+  const int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+  if(fd < 0) throw std::system_error(errno, std::generic_category(),
+    fmt::format("failed to open {}", file.native()));
+
+  struct stat st;
+  if(fstat(fd, &st)) {
+    const int err = errno;
+    close(fd);
+    throw std::system_error(err, std::generic_category(), "failed to stat");
+  }
+  if((std::size_t)st.st_size < headerLen) {
+    close(fd);
+    throw std::runtime_error("bad vault header");
+  }
+
+  mapLen = st.st_size;
+  void *addr = mmap(NULL, mapLen, PROT_READ, MAP_PRIVATE, fd, 0);
+  const int err = errno;
+  close(fd);
+  if(addr == MAP_FAILED)
+    throw std::system_error(err, std::generic_category(), "failed to map");
+  map = (const unsigned char *)addr;
+
+  std::uint32_t version, count32;
+  deserialize(version, map + sizeof(vaultMagic));
+  deserialize(count32, map + sizeof(vaultMagic) + 4);
+  count = count32;
+  if(std::memcmp(map, vaultMagic, sizeof(vaultMagic))
+      || version != vaultVersion
+      || (mapLen - headerLen) / indexEntryLen < count) {
+    munmap(const_cast<unsigned char *>(map), mapLen);
+    throw std::runtime_error("bad vault header");
+  }
+
+  loaded.resize(count, NULL);
+}
+
+VaultFile::~VaultFile() {
+  munmap(const_cast<unsigned char *>(map), mapLen);
+}
+
+const unsigned char *
+VaultFile::indexEntry(std::size_t i) const {
+  return map + headerLen + i * indexEntryLen;
+}
+
+// Checks bounds lazily, so that opening a vault touches only its header.
+std::string_view
+VaultFile::slice(std::uint64_t offset, std::uint32_t len) const {
+  if(offset > mapLen || mapLen - offset < len)
+    throw std::runtime_error("corrupt vault index");
+  return std::string_view((const char *)map + offset, len);
+}
+
+std::string_view
+VaultFile::idAt(std::size_t i) const {
+  if(i >= count) throw std::out_of_range("vault index out of range");
+  std::uint64_t offset;
+  std::uint32_t len;
+  deserialize(offset, indexEntry(i));
+  deserialize(len, indexEntry(i) + 16);
+  return slice(offset, len);
+}
+
+std::size_t
+VaultFile::find(std::string_view id) const {
+  std::size_t lo = 0, hi = count;
+  while(lo < hi) {
+    const std::size_t mid = lo + (hi - lo) / 2;
+    if(idAt(mid) < id) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo < count && idAt(lo) == id ? lo : count;
+}
+
+bool
+VaultFile::contains(std::string_view id) const {
+  return find(id) != count;
+}
+
+nlohmann::json
+VaultFile::recordAt(std::size_t i) const {
+  std::uint64_t offset;
+  std::uint32_t len;
+  deserialize(offset, indexEntry(i) + 8);
+  deserialize(len, indexEntry(i) + 20);
+  const std::string_view record = slice(offset, len);
+  return nlohmann::json::from_msgpack(
+    (const unsigned char *)record.data(),
+    (const unsigned char *)record.data() + record.size());
+}
+
+nlohmann::json
+VaultFile::getRecord(std::string_view id) const {
+  const std::size_t i = find(id);
+  if(i == count)
+    throw std::out_of_range(fmt::format("no password with ID: {}", id));
+  return recordAt(i);
+}
+
+Password&
+VaultFile::getPassword(std::string_view id) {
+  const std::size_t i = find(id);
+  if(i == count)
+    throw std::out_of_range(fmt::format("no password with ID: {}", id));
+  if(loaded[i]) return *loaded[i];
+
+  const nlohmann::json record = recordAt(i);
+  if(record.at("id").get<std::string_view>() != id)
+    throw std::runtime_error("corrupt vault index");
+  loaded[i] = genpass.loadPassword(record);
+  if(!loaded[i]) throw std::runtime_error(fmt::format(
+    "no loader for algorithm: {}", record.at("algorithm").get<std::string>()));
+  return *loaded[i];
+}
+
+void
+VaultFile::registerAlgorithm(const std::string& name,
+  std::function<Password *()> constructor
+) {
+  genpass.registerAlgorithm(name, std::move(constructor));
+}
+
+void
+VaultFile::write(const Genpass& genpass, const std::filesystem::path& file) {
+  std::vector<const Password *> sorted;
+  for(auto it = genpass.passwords_cbegin(); it != genpass.passwords_cend();
+      ++it)
+    sorted.push_back(&*it);
+  std::sort(sorted.begin(), sorted.end(),
+    [](const Password *a, const Password *b) { return a->id < b->id; });
+
+  // lay out the IDs after the index and the records after the IDs
+  const std::size_t indexEnd = headerLen + sorted.size() * indexEntryLen;
+  std::size_t idEnd = indexEnd;
+  for(const Password *password : sorted) idEnd += password->id.size();
+
+  std::vector<std::uint8_t> records;
+  std::vector<unsigned char> header(indexEnd);
+  std::memcpy(header.data(), vaultMagic, sizeof(vaultMagic));
+  serialize(header.data() + sizeof(vaultMagic), vaultVersion);
+  serialize(header.data() + sizeof(vaultMagic) + 4,
+    (std::uint32_t)sorted.size());
+
+  std::uint64_t idOffset = indexEnd;
+  for(std::size_t i = 0; i < sorted.size(); i++) {
+    const std::size_t recordStart = records.size();
+    nlohmann::json::to_msgpack(sorted[i]->serialize(), records);
+
+    unsigned char *entry = header.data() + headerLen + i * indexEntryLen;
+    serialize(entry, idOffset);
+    serialize(entry + 8, (std::uint64_t)(idEnd + recordStart));
+    serialize(entry + 16, (std::uint32_t)sorted[i]->id.size());
+    serialize(entry + 20, (std::uint32_t)(records.size() - recordStart));
+    idOffset += sorted[i]->id.size();
+  }
+
+  detail::atomicWrite(file, [&](std::ostream& out) {
+    out.write((const char *)header.data(), header.size());
+    for(const Password *password : sorted)
+      out.write(password->id.data(), password->id.size());
+    out.write((const char *)records.data(), records.size());
+  });
+}
+
+void
+VaultFile::fromJson(const std::filesystem::path& json,
+  const std::filesystem::path& vault
+) {
+  Genpass genpass;
+  genpass.loadFrom(json);
+  write(genpass, vault);
+}
+
+// Copies the records as they are, so passwords of unregistered algorithms
+// survive the conversion.
+void
+VaultFile::toJson(const std::filesystem::path& vault,
+  const std::filesystem::path& json
+) {
+  const VaultFile in(vault);
+  detail::atomicWrite(json, [&](std::ostream& out) {
+    out << "{\"passwords\":[";
+    for(std::size_t i = 0; i < in.count; i++) {
+      if(i) out << ',';
+      out << in.recordAt(i);
+    }
+    out << "]}\n";
+  });
+}
+
+} // namespace genpass
@@ -0,0 +1,155 @@
+/* ---------------------------------------------------------------------- *\
+ * src/VaultFormat.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/VaultFormat.hpp"
+
+#include <fmt/format.h>  // for format
+#include <fstream>       // for ifstream
+#include <ostream>       // for ostream
+#include <stdexcept>     // for invalid_argument, runtime_error
+#include <string>        // for string
+#include <utility>       // for move
+
+#include "genpass/detail/atomicWrite.hpp"  // for atomicWrite
+
+namespace genpass {
+
+static const struct {
+  VaultFormat format;
+  const char *name;
+} formatNames[] = {
+  {VaultFormat::json, "json"},
+  {VaultFormat::cbor, "cbor"},
+  {VaultFormat::msgpack, "msgpack"},
+  {VaultFormat::ubjson, "ubjson"},
+  {VaultFormat::bson, "bson"},
+};
+
+const char *
+vaultFormatName(VaultFormat format) {
+  for(const auto& entry : formatNames)
+    if(entry.format == format) return entry.name;
+  throw std::invalid_argument("unknown vault format");
+}
+
+VaultFormat
+vaultFormatFromName(std::string_view name) {
+  for(const auto& entry : formatNames)
+    if(name == entry.name) return entry.format;
+  throw std::invalid_argument(fmt::format("unknown vault format: {}", name));
+}
+
+VaultFormat
+detectVaultFormat(std::string_view head, std::uintmax_t size) {
+  if(head.size() < 5) return VaultFormat::json;
+  const auto byte = [&](std::size_t i) { return (unsigned char)head[i]; };
+
+  // a BSON document starts with its own length, then the type of its first
+  // element (or the terminating zero of an empty document)
+  const std::uintmax_t bsonLen = byte(0) | byte(1) << 8 | byte(2) << 16
+    | (std::uintmax_t)byte(3) << 24;
+  if(bsonLen == size && (byte(4) <= 0x13 || byte(4) == 0x7f || byte(4) == 0xff))
+    return VaultFormat::bson;
+
+  const unsigned char first = byte(0);
+  // a map, possibly behind the "self-described CBOR" tag
+  if((first >= 0xa0 && first <= 0xbb) || first == 0xbf
+      || (first == 0xd9 && byte(1) == 0xd9 && byte(2) == 0xf7))
+    return VaultFormat::cbor;
+  if((first >= 0x80 && first <= 0x8f) || first == 0xde || first == 0xdf)
+    return VaultFormat::msgpack;
+  // a UBJSON object also starts with '{', but is followed by the type of
+  // the first key's length or a container optimization, rather than by
+  // whitespace or a quote
+  if(first == '{' && std::string_view("iUIlL$#").find(head[1]) != head.npos)
+    return VaultFormat::ubjson;
+  return VaultFormat::json;
+}
+
+VaultFormat
+detectVaultFormat(const std::filesystem::path& file) {
+  std::ifstream in(file, std::ios_base::binary);
+  if(!in) throw std::runtime_error(
+    fmt::format("failed to open {}", file.native()));
+  char head[8];
+  in.read(head, sizeof(head));
+  return detectVaultFormat(std::string_view(head, in.gcount()),
+    std::filesystem::file_size(file));
+}
+
+void
+convertVault(const std::filesystem::path& in,
+  const std::filesystem::path& out, VaultFormat format
+) {
+  const VaultFormat inFormat = detectVaultFormat(in);
+  std::ifstream inStream(in, std::ios_base::binary);
+  if(!inStream) throw std::runtime_error(
+    fmt::format("failed to open {}", in.native()));
+
+  nlohmann::json vault;
+  switch(inFormat) {
+    case VaultFormat::cbor: vault = nlohmann::json::from_cbor(inStream); break;
+    case VaultFormat::msgpack:
+      vault = nlohmann::json::from_msgpack(inStream);
+      break;
+    case VaultFormat::ubjson:
+      vault = nlohmann::json::from_ubjson(inStream);
+      break;
+    case VaultFormat::bson: vault = nlohmann::json::from_bson(inStream); break;
+    default: vault = nlohmann::json::parse(inStream); break;
+  }
+  inStream.close();
+
+  // the keys of `vault` are sorted, which puts "passwords" first
+  nlohmann::ordered_json ordered;
+  if(vault.is_object()) {
+    if(const auto it = vault.find("policies"); it != vault.end())
+      ordered["policies"] = std::move(*it);
+    for(auto& [key, value] : vault.items())
+      if(key != "policies") ordered[key] = std::move(value);
+  } else ordered = std::move(vault);
+
+  detail::atomicWrite(out, [&](std::ostream& outStream) {
+    detail::writeVault(ordered, outStream, format);
+  });
+}
+
+namespace detail {
+
+void
+writeVault(const nlohmann::ordered_json& vault, std::ostream& out,
+  VaultFormat format
+) {
+  switch(format) {
+    case VaultFormat::cbor: nlohmann::ordered_json::to_cbor(vault, out); break;
+    case VaultFormat::msgpack:
+      nlohmann::ordered_json::to_msgpack(vault, out);
+      break;
+    case VaultFormat::ubjson:
+      nlohmann::ordered_json::to_ubjson(vault, out);
+      break;
+    case VaultFormat::bson: nlohmann::ordered_json::to_bson(vault, out); break;
+    default: out << vault << '\n'; break;
+  }
+}
+
+} // namespace detail
+
+} // namespace genpass
@@ -0,0 +1,194 @@
+/* ---------------------------------------------------------------------- *\
+ * src/VaultLoader.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/detail/VaultLoader.hpp"
+
+#include <stdexcept>  // for runtime_error
+#include <utility>    // for move
+
+#include "genpass/Genpass.hpp"  // for Genpass
+
+namespace genpass::detail {
+
+// Enough entries to keep every worker busy, few enough that holding them as
+// JSON is cheap.
+static const std::size_t batchSize = 4096;
+
+bool
+JsonBuilder::value(nlohmann::json&& v) {
+  put(std::move(v));
+  return stack.empty();
+}
+
+void
+JsonBuilder::startContainer(nlohmann::json&& empty) {
+  stack.push_back(put(std::move(empty)));
+}
+
+bool
+JsonBuilder::endContainer() {
+  stack.pop_back();
+  return stack.empty();
+}
+
+void
+JsonBuilder::key(std::string&& k) {
+  pendingKey = std::move(k);
+}
+
+nlohmann::json
+JsonBuilder::take() {
+  nlohmann::json ret = std::move(root);
+  root = nullptr;
+  return ret;
+}
+
+nlohmann::json *
+JsonBuilder::put(nlohmann::json&& v) {
+  if(stack.empty()) {
+    root = std::move(v);
+    return &root;
+  }
+  nlohmann::json& top = *stack.back();
+  if(top.is_array()) {
+    top.push_back(std::move(v));
+    return &top.back();
+  }
+  nlohmann::json& slot = top[pendingKey];
+  slot = std::move(v);
+  return &slot;
+}
+
+VaultLoader::VaultLoader(Genpass& genpass)
+  : genpass(genpass), depth(0), inPasswords(false), sawPasswords(false),
+    unknownAlg(false)
+{ }
+
+void
+VaultLoader::finish() {
+  if(!sawPasswords) throw std::runtime_error("vault has no passwords");
+  flush();
+  batch.swap(deferred);
+  flush();
+  GENPASS_RECORD("vault.parse", parseTime.elapsed(), 0);
+  if(unknownAlg) genpass.warnUnknownAlgorithms();
+}
+
+bool
+VaultLoader::value(json&& v) {
+  if(depth == 0) throw std::runtime_error("vault is not a JSON object");
+  if(depth == 1) return true; // some other top-level scalar; ignore it
+  if(inPasswords && depth == 2)
+    throw std::runtime_error("password entry is not an object");
+  builder.value(std::move(v));
+  return true;
+}
+
+bool
+VaultLoader::startContainer(json&& empty) {
+  depth++;
+  if(depth == 1) {
+    if(!empty.is_object())
+      throw std::runtime_error("vault is not a JSON object");
+    return true;
+  }
+  if(depth == 2 && topKey == "passwords") {
+    if(!empty.is_array())
+      throw std::runtime_error("vault passwords is not an array");
+    inPasswords = sawPasswords = true;
+    return true;
+  }
+  if(inPasswords && depth == 3 && !empty.is_object())
+    throw std::runtime_error("password entry is not an object");
+  builder.startContainer(std::move(empty));
+  return true;
+}
+
+bool
+VaultLoader::endContainer() {
+  const std::size_t closing = depth--;
+  if(closing == 1) return true;
+  if(inPasswords && closing == 2) {
+    inPasswords = false;
+    return true;
+  }
+
+  if(builder.endContainer()) {
+    nlohmann::json value = builder.take();
+    if(inPasswords) {
+      if(policies.is_null() && value.contains("policy"))
+        deferred.push_back(std::move(value));
+      else
+        load(std::move(value));
+    } else if(closing == 2 && topKey == "policies") {
+      policies = std::move(value);
+    }
+    // other top-level values are not used
+  }
+  return true;
+}
+
+void
+VaultLoader::load(json&& entry) {
+  batch.push_back(std::move(entry));
+  if(batch.size() >= batchSize) flush();
+}
+
+void
+VaultLoader::flush() {
+  if(batch.empty()) return;
+  if(!genpass.loadPasswords(batch,
+      policies.is_object() ? &policies : NULL))
+    unknownAlg = true;
+  batch.clear();
+}
+
+bool VaultLoader::null() { return value(nullptr); }
+bool VaultLoader::boolean(bool val) { return value(val); }
+bool VaultLoader::number_integer(json::number_integer_t val) {
+  return value(val);
+}
+bool VaultLoader::number_unsigned(json::number_unsigned_t val) {
+  return value(val);
+}
+bool VaultLoader::number_float(json::number_float_t val, const json::string_t&) {
+  return value(val);
+}
+bool VaultLoader::string(json::string_t& val) { return value(std::move(val)); }
+bool VaultLoader::binary(json::binary_t& val) {
+  return value(json::binary(std::move(val)));
+}
+bool VaultLoader::start_object(std::size_t) {
+  return startContainer(json::object());
+}
+bool VaultLoader::end_object() { return endContainer(); }
+bool VaultLoader::start_array(std::size_t) {
+  return startContainer(json::array());
+}
+bool VaultLoader::end_array() { return endContainer(); }
+
+bool
+VaultLoader::key(json::string_t& val) {
+  if(depth == 1) topKey = val;
+  else builder.key(std::move(val));
+  return true;
+}
+
+} // namespace genpass::detail
@@ -0,0 +1,63 @@
+/* ---------------------------------------------------------------------- *\
+ * src/VaultPolicies.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/detail/VaultPolicies.hpp"
+
+namespace genpass::detail {
+
+void
+VaultPolicies::add(const Password& password) {
+  const Policy *policy = password.getPolicy();
+  if(!policy || keys.contains(policy)) return;
+
+  // a name used by a different policy is left out, so that its entries
+  // keep their own fields
+  std::string key = policy->getName();
+  if(key.empty()) key = "#" + std::to_string(keys.size());
+  else if(policies.contains(key)) return;
+
+  policy->serialize(policies[key]);
+  keys.emplace(policy, std::move(key));
+}
+
+void
+VaultPolicies::compact(const Password& password, nlohmann::json& entry) const {
+  const auto key = keys.find(password.getPolicy());
+  if(key == keys.end()) return;
+  for(const auto& field : policies.at(key->second).items())
+    entry.erase(field.key());
+  entry["policy"] = key->second;
+}
+
+void
+VaultPolicies::expand(nlohmann::json& entry, const nlohmann::json& policies) {
+  const auto ref = entry.find("policy");
+  if(ref == entry.end() || !ref->is_string()) return;
+  const std::string key = ref->get<std::string>();
+
+  const auto policy = policies.find(key);
+  if(policy != policies.end()) {
+    for(const auto& field : policy->items())
+      if(!entry.contains(field.key())) entry[field.key()] = field.value();
+  }
+  if(key.starts_with('#')) entry.erase("policy");
+}
+
+} // namespace genpass::detail
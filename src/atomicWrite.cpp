@@ -0,0 +1,139 @@
+/* ---------------------------------------------------------------------- *\
+ * src/atomicWrite.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/detail/atomicWrite.hpp"
+
+#include <fstream>       // for ofstream
+#include <system_error>  // for system_error, generic_category, error_code
+
+#ifndef _WIN32
+#include <errno.h>       // for errno
+#include <fcntl.h>       // for open, O_RDONLY, O_DIRECTORY
+#include <stdlib.h>      // for mkstemp
+#include <sys/stat.h>    // for stat, fchmod
+#include <unistd.h>      // for close, fsync, unlink
+#else
+#ifndef NOMINMAX
+#define NOMINMAX         // keep std::min and std::max usable
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>     // for CreateFileW, FlushFileBuffers, MoveFileExW
+#endif
+
+namespace genpass::detail {
+
+#ifndef _WIN32
+
+static std::system_error
+sysError(const char *what) {
+  return std::system_error(errno, std::generic_category(), what);
+}
+
+void
+atomicWrite(const std::filesystem::path& file,
+  const std::function<void(std::ostream&)>& write
+) {
+  std::string tmpName = file.native() + ".tmp-XXXXXX";
+  const int fd = mkstemp(tmpName.data());
+  if(fd < 0) throw sysError("failed to create temporary file");
+
+  try {
+    // keep the permissions of the file being replaced
+    struct stat st;
+    if(!stat(file.c_str(), &st) && fchmod(fd, st.st_mode & 07777))
+      throw sysError("failed to set file permissions");
+
+    {
+      std::ofstream out(tmpName, std::ios_base::binary | std::ios_base::trunc);
+      out.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+      write(out);
+      out.close();
+    }
+
+    // any descriptor of the file will do for syncing its data
+    if(fsync(fd)) throw sysError("failed to sync temporary file");
+    if(rename(tmpName.c_str(), file.c_str()))
+      throw sysError("failed to replace file");
+  } catch(...) {
+    close(fd);
+    unlink(tmpName.c_str());
+    throw;
+  }
+  close(fd);
+
+  // make the rename itself durable
+  std::filesystem::path dir = file.parent_path();
+  if(dir.empty()) dir = ".";
+  const int dirFd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if(dirFd >= 0) {
+    fsync(dirFd);
+    close(dirFd);
+  }
+}
+
+#else // _WIN32
+
+static std::system_error
+sysError(const char *what) {
+  return std::system_error(GetLastError(), std::system_category(), what);
+}
+
+void
+atomicWrite(const std::filesystem::path& file,
+  const std::function<void(std::ostream&)>& write
+) {
+  std::filesystem::path tmp = file;
+  tmp += ".tmp";
+  try {
+    {
+      std::ofstream out(tmp, std::ios_base::binary | std::ios_base::trunc);
+      out.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+      write(out);
+      out.close();
+    }
+
+    // the stream can't be synced, so sync the file through a new handle
+    const HANDLE handle = CreateFileW(tmp.c_str(), GENERIC_WRITE, 0, NULL,
+      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(handle == INVALID_HANDLE_VALUE)
+      throw sysError("failed to open temporary file");
+    if(!FlushFileBuffers(handle)) {
+      const std::system_error err = sysError("failed to sync temporary file");
+      CloseHandle(handle);
+      throw err;
+    }
+    CloseHandle(handle);
+
+    // write-through, so that the rename is durable when this returns
+    if(!MoveFileExW(tmp.c_str(), file.c_str(),
+        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+      throw sysError("failed to replace file");
+  } catch(...) {
+    std::error_code ignored;
+    std::filesystem::remove(tmp, ignored);
+    throw;
+  }
+}
+
+#endif // _WIN32
+
+} // namespace genpass::detail
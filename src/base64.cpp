@@ -0,0 +1,74 @@
+/* ---------------------------------------------------------------------- *\
+ * src/base64.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/detail/base64.hpp"
+
+#include <cstdint>  // for uint32_t
+
+namespace genpass::detail {
+
+static constexpr char alphabet[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::size_t
+base64Filtered(const unsigned char *in, std::size_t len,
+  const CharClass& banned, char *out, std::size_t cap
+) {
+  std::size_t n = 0;
+  std::size_t i = 0;
+
+  // Whole groups while there is room for all four characters. Every
+  // character is stored and the cursor only advances past allowed ones, so
+  // there are no branches on the data.
+  for(; i + 3 <= len && cap - n >= 4; i += 3) {
+    const std::uint32_t v = (std::uint32_t)in[i] << 16
+      | (std::uint32_t)in[i + 1] << 8 | in[i + 2];
+    const char c0 = alphabet[v >> 18];
+    const char c1 = alphabet[(v >> 12) & 63];
+    const char c2 = alphabet[(v >> 6) & 63];
+    const char c3 = alphabet[v & 63];
+    out[n] = c0; n += !banned.contains(c0);
+    out[n] = c1; n += !banned.contains(c1);
+    out[n] = c2; n += !banned.contains(c2);
+    out[n] = c3; n += !banned.contains(c3);
+  }
+
+  // the rest, including the padded final group, one character at a time
+  for(; i < len && n < cap; i += 3) {
+    const std::size_t rem = len - i;
+    std::uint32_t v = (std::uint32_t)in[i] << 16;
+    if(rem > 1) v |= (std::uint32_t)in[i + 1] << 8;
+    if(rem > 2) v |= in[i + 2];
+    const char group[4] = {
+      alphabet[v >> 18],
+      alphabet[(v >> 12) & 63],
+      rem > 1 ? alphabet[(v >> 6) & 63] : '=',
+      rem > 2 ? alphabet[v & 63] : '='
+    };
+    for(const char c : group) {
+      if(n == cap) break;
+      if(!banned.contains(c)) out[n++] = c;
+    }
+  }
+
+  return n;
+}
+
+} // namespace genpass::detail
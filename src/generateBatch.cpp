@@ -0,0 +1,157 @@
+/* ---------------------------------------------------------------------- *\
+ * src/generateBatch.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/detail/generateBatch.hpp"
+
+#include <openssl/crypto.h>  // for OPENSSL_cleanse
+#include <openssl/evp.h>     // for EVP_MAC_CTX_free
+#include <memory>            // for shared_ptr
+#include <typeinfo>          // for type_info
+
+#include "genpass/Password.hpp"           // for Password, PasswordV2
+#include "genpass/SecureString.hpp"       // for SecureString
+#include "genpass/detail/HmacSha256.hpp"  // for HmacSha256
+#include "genpass/detail/instrument.hpp"  // for GENPASS_TIME
+#include "genpass/detail/parallel.hpp"    // for parallelFor
+
+namespace genpass::detail {
+
+// Finishes a plain PasswordV2 from its MAC into `result`.
+static void
+fromMac(const PasswordV2& password, const unsigned char *mac,
+  std::size_t macLen, std::string& result
+) {
+  result = password.fromMac(mac, macLen);
+}
+
+static void
+fromMac(const PasswordV2& password, const unsigned char *mac,
+  std::size_t macLen, SecureString& result
+) {
+  result = SecureString(password.policy->getLength());
+  password.fromMacInto(mac, macLen, result.span());
+}
+
+static void
+generateOne(const Password& password, const Seed& seed, EVP_MAC_CTX *mac,
+  std::string& result
+) {
+  result = password.generate(seed, mac);
+}
+
+static void
+generateOne(const Password& password, const Seed& seed, EVP_MAC_CTX *mac,
+  SecureString& result
+) {
+  result = password.generateSecure(seed, mac);
+}
+
+// Generates passwords for the PasswordV2 entries at `indices` with the
+// built-in multi-buffer HMAC, all in one go.
+template<typename Result>
+static void
+generateLanes(
+  const HmacSha256& engine,
+  const std::vector<const Password *>& batch,
+  const std::size_t *indices,
+  std::size_t count,
+  std::vector<Result>& results
+) {
+  GENPASS_TIME("passwordV2.generateLanes", 0);
+  constexpr std::size_t lanes = HmacSha256::lanes;
+  std::shared_ptr<const std::string> messages[lanes];
+  const unsigned char *msgs[lanes];
+  std::size_t lens[lanes];
+  unsigned char macBuf[lanes][HmacSha256::macSize];
+  unsigned char *macs[lanes];
+
+  for(std::size_t lane = 0; lane < count; lane++) {
+    messages[lane] =
+      static_cast<const PasswordV2 *>(batch[indices[lane]])->macMessage();
+    msgs[lane] = (const unsigned char *)messages[lane]->data();
+    lens[lane] = messages[lane]->length();
+    macs[lane] = macBuf[lane];
+  }
+  engine.macMulti(count, msgs, lens, macs);
+  for(std::size_t lane = 0; lane < count; lane++) {
+    fromMac(*static_cast<const PasswordV2 *>(batch[indices[lane]]),
+      macs[lane], sizeof(macBuf[lane]), results[indices[lane]]);
+  }
+  OPENSSL_cleanse(macBuf, sizeof(macBuf));
+}
+
+template<typename Result>
+static std::vector<Result>
+generateAll(
+  const Seed& seed,
+  const std::vector<const Password *>& batch,
+  unsigned threads
+) {
+  GENPASS_TIME("generateBatch", 0);
+  const HmacSha256 *engine = seed.getHmacEngine();
+  std::vector<Result> results(batch.size());
+  parallelFor(batch.size(), threads,
+    [&](std::size_t begin, std::size_t end, unsigned) {
+      // each worker keeps its own MAC context, made once it is needed
+      Seed::EVP_MAC_CTX_ptr mac(NULL, &EVP_MAC_CTX_free);
+
+      constexpr std::size_t lanes = HmacSha256::lanes;
+      std::size_t pending[lanes];
+      std::size_t npending = 0;
+
+      for(std::size_t i = begin; i < end; i++) {
+        // plain PasswordV2 entries go through the multi-buffer HMAC
+        if(engine && typeid(*batch[i]) == typeid(PasswordV2)) {
+          pending[npending++] = i;
+          if(npending == lanes) {
+            generateLanes(*engine, batch, pending, npending, results);
+            npending = 0;
+          }
+        } else {
+          if(!mac) mac = seed.newMac();
+          generateOne(*batch[i], seed, mac.get(), results[i]);
+        }
+      }
+      if(npending)
+        generateLanes(*engine, batch, pending, npending, results);
+    }
+  );
+  return results;
+}
+
+std::vector<std::string>
+generateBatch(
+  const Seed& seed,
+  const std::vector<const Password *>& batch,
+  unsigned threads
+) {
+  return generateAll<std::string>(seed, batch, threads);
+}
+
+std::vector<SecureString>
+generateBatchSecure(
+  const Seed& seed,
+  const std::vector<const Password *>& batch,
+  unsigned threads
+) {
+  return generateAll<SecureString>(seed, batch, threads);
+}
+
+} // namespace genpass::detail
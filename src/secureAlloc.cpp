@@ -0,0 +1,210 @@
+/* ---------------------------------------------------------------------- *\
+ * src/secureAlloc.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+#include "genpass/detail/secureAlloc.hpp"
+
+#include <fmt/base.h>        // for println
+#include <openssl/crypto.h>  // for OPENSSL_cleanse
+#include <stdio.h>           // for stderr
+#include <algorithm>         // for max
+#include <atomic>            // for atomic
+#include <bit>               // for bit_ceil, countr_zero
+#include <cstring>           // for memset
+#include <mutex>             // for mutex, lock_guard
+#include <new>               // for bad_alloc
+
+#ifndef _WIN32
+#include <sys/mman.h>        // for mmap, munmap, mlock, munlock, madvise
+#include <unistd.h>          // for sysconf
+#else
+#ifndef NOMINMAX
+#define NOMINMAX             // keep std::min and std::max usable
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>         // for VirtualAlloc, VirtualFree, VirtualLock
+#endif
+
+#include "genpass/detail/instrument.hpp"  // for GENPASS_COUNT
+
+namespace genpass::detail {
+
+// slots come in powers of two from minSlot to maxSlot, carved from chunks
+static const std::size_t minSlot = 32;
+static const std::size_t maxSlot = 4096;
+static const std::size_t classCount =
+  std::countr_zero(maxSlot) - std::countr_zero(minSlot) + 1;
+static const std::size_t chunkLen = 1 << 16;
+
+#ifndef _WIN32
+
+static std::size_t
+pageSize() {
+  return sysconf(_SC_PAGESIZE);
+}
+
+static void *
+mapPages(std::size_t len) {
+  void *p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(p == MAP_FAILED) throw std::bad_alloc();
+#ifdef MADV_DONTDUMP
+  madvise(p, len, MADV_DONTDUMP);
+#endif
+  return p;
+}
+
+static bool
+lockPages(void *p, std::size_t len) {
+  return !mlock(p, len);
+}
+
+static void
+unmapPages(void *p, std::size_t len) {
+  munlock(p, len);
+  munmap(p, len);
+}
+
+#else // _WIN32
+
+static std::size_t
+pageSize() {
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwPageSize;
+}
+
+static void *
+mapPages(std::size_t len) {
+  void *p = VirtualAlloc(NULL, len, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  if(!p) throw std::bad_alloc();
+  return p;
+}
+
+static bool
+lockPages(void *p, std::size_t len) {
+  return VirtualLock(p, len);
+}
+
+static void
+unmapPages(void *p, std::size_t len) {
+  VirtualUnlock(p, len);
+  VirtualFree(p, 0, MEM_RELEASE);
+}
+
+#endif // _WIN32
+
+// Locks new pages, or warns once that it can't. The pages are still used,
+// and still zeroed on release, if they can't be locked.
+static void *
+mapLockedPages(std::size_t len) {
+  static std::atomic<bool> warned = false;
+  void *p = mapPages(len);
+  if(!lockPages(p, len) && !warned.exchange(true)) {
+    fmt::println(stderr, "warning: failed to lock memory for secrets;"
+      " they may be written to swap");
+  }
+  return p;
+}
+
+namespace {
+
+// Free slots of each size, linked through their first bytes. Chunks are
+// never handed back to the system, so that a slot only ever holds secrets.
+class SlotPool {
+public:
+  void *allocate(std::size_t cls) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    if(!free[cls]) refill(cls);
+    FreeSlot *slot = free[cls];
+    free[cls] = slot->next;
+    std::memset(slot, 0, sizeof(*slot));
+    return slot;
+  }
+
+  void release(void *p, std::size_t cls) noexcept {
+    OPENSSL_cleanse(p, minSlot << cls);
+    const std::lock_guard<std::mutex> lock(mutex);
+    FreeSlot *slot = (FreeSlot *)p;
+    slot->next = free[cls];
+    free[cls] = slot;
+  }
+
+private:
+  struct FreeSlot {
+    FreeSlot *next;
+  };
+
+  void refill(std::size_t cls) {
+    GENPASS_COUNT("alloc.secureChunk", chunkLen);
+    unsigned char *chunk = (unsigned char *)mapLockedPages(chunkLen);
+    const std::size_t slotLen = minSlot << cls;
+    for(std::size_t off = chunkLen; off > 0; off -= slotLen) {
+      FreeSlot *slot = (FreeSlot *)(chunk + off - slotLen);
+      slot->next = free[cls];
+      free[cls] = slot;
+    }
+  }
+
+  std::mutex mutex;
+  FreeSlot *free[classCount] = {};
+};
+
+} // namespace
+
+// Never destroyed, so that secrets in static storage can outlive it.
+static SlotPool&
+slotPool() {
+  static SlotPool *pool = new SlotPool();
+  return *pool;
+}
+
+static std::size_t
+slotClass(std::size_t size) {
+  return std::countr_zero(std::bit_ceil(std::max(size, minSlot)))
+    - std::countr_zero(minSlot);
+}
+
+static std::size_t
+roundToPages(std::size_t size) {
+  const std::size_t page = pageSize();
+  return (size + page - 1) / page * page;
+}
+
+void *
+secureAllocate(std::size_t size) {
+  if(size <= maxSlot) return slotPool().allocate(slotClass(size));
+  GENPASS_COUNT("alloc.secureLarge", size);
+  return mapLockedPages(roundToPages(size));
+}
+
+void
+secureRelease(void *p, std::size_t size) noexcept {
+  if(!p) return;
+  if(size <= maxSlot) {
+    slotPool().release(p, slotClass(size));
+  } else {
+    OPENSSL_cleanse(p, size);
+    unmapPages(p, roundToPages(size));
+  }
+}
+
+} // namespace genpass::detail
@@ -0,0 +1,134 @@
+/* ---------------------------------------------------------------------- *\
+ * tools/genpass-agent.cpp
+ * This file is part of GenPass.
+ *
+ * Copyright (C) 2026      David Bears <dbear4q@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+\* ---------------------------------------------------------------------- */
+
+// Unlocks a seed file once and serves password generation to the same
+// user over a Unix domain socket, in the manner of ssh-agent.
+//
+// usage: genpass-agent [-s SOCKET] SEEDFILE
+//
+// The seed password is read from the terminal. Once the seed is unlocked,
+// a line suitable for `eval` is printed that sets GENPASS_AGENT_SOCK, and
+// the agent serves until it receives SIGINT, SIGTERM or a stop request.
+
+#include <fmt/base.h>        // for println
+#include <openssl/crypto.h>  // for OPENSSL_cleanse
+#include <signal.h>          // for sigaction, SIGINT, SIGTERM
+#include <stdio.h>           // for stderr, stdout
+#include <sys/mman.h>        // for mlockall, MCL_CURRENT, MCL_FUTURE
+#include <sys/resource.h>    // for setrlimit, RLIMIT_CORE
+#include <termios.h>         // for tcgetattr, tcsetattr, ECHO
+#include <unistd.h>          // for isatty, STDIN_FILENO
+#include <atomic>            // for atomic
+#include <filesystem>        // for path
+#include <iostream>          // for cin, cerr
+#include <string>            // for string, getline
+
+#ifdef __linux__
+#include <sys/prctl.h>       // for prctl, PR_SET_DUMPABLE
+#endif
+
+#include "genpass/Agent.hpp"  // for AgentServer, defaultAgentSocket
+#include "genpass/Seed.hpp"   // for Seed
+
+static std::atomic<genpass::AgentServer *> server;
+
+static void
+onSignal(int) {
+  if(genpass::AgentServer *s = server.load()) s->stop();
+}
+
+// Keeps the seed out of swap and core dumps.
+static void
+protectMemory() {
+  if(mlockall(MCL_CURRENT | MCL_FUTURE))
+    fmt::println(stderr, "warning: failed to lock memory;"
+      " the seed may be swapped to disk");
+  const rlimit noCore{0, 0};
+  setrlimit(RLIMIT_CORE, &noCore);
+#ifdef __linux__
+  prctl(PR_SET_DUMPABLE, 0);
+#endif
+}
+
+static std::string
+readPassword() {
+  std::string password;
+  const bool tty = isatty(STDIN_FILENO);
+  termios old;
+  if(tty) {
+    std::cerr << "Seed password: " << std::flush;
+    tcgetattr(STDIN_FILENO, &old);
+    termios noEcho = old;
+    noEcho.c_lflag &= ~ECHO;
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &noEcho);
+  }
+  std::getline(std::cin, password);
+  if(tty) {
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &old);
+    std::cerr << std::endl;
+  }
+  return password;
+}
+
+int
+main(int argc, char **argv) {
+  std::filesystem::path socket = genpass::defaultAgentSocket();
+  std::filesystem::path seedFile;
+  for(int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if(arg == "-s" && i + 1 < argc) socket = argv[++i];
+    else if(seedFile.empty() && arg[0] != '-') seedFile = arg;
+    else {
+      fmt::println(stderr, "usage: {} [-s SOCKET] SEEDFILE", argv[0]);
+      return 2;
+    }
+  }
+  if(seedFile.empty()) {
+    fmt::println(stderr, "usage: {} [-s SOCKET] SEEDFILE", argv[0]);
+    return 2;
+  }
+
+  protectMemory();
+
+  try {
+    std::string password = readPassword();
+    const genpass::Seed seed =
+      genpass::Seed::fromEncryptedFile(seedFile, password);
+    OPENSSL_cleanse(password.data(), password.size());
+
+    genpass::AgentServer agent(seed, socket);
+    server = &agent;
+    struct sigaction action{};
+    action.sa_handler = &onSignal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    fmt::println("GENPASS_AGENT_SOCK={}; export GENPASS_AGENT_SOCK;",
+      socket.native());
+    std::fflush(stdout);
+
+    agent.serve();
+    server = nullptr;
+  } catch(const std::exception& e) {
+    fmt::println(stderr, "error: {}", e.what());
+    return 1;
+  }
+  return 0;
+}